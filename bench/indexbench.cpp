@@ -0,0 +1,266 @@
+/* XDGSearch is a XAPIAN based file indexer and search tool.
+
+    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// indexbench [options], see --help
+/// generates a synthetic pool under a temporary directory: many small text files in a deep tree, a few huge ones
+/// and files of mixed extensions, the pdf and mp3 files are extracted by local stand-ins for pstotext and mediainfo
+/// that sleep and print a canned text of a given size. Then it runs populateDB() end to end as "xdgsearch index"
+/// does, with the settings and the databases kept under the temporary directory, so the real ones are untouched.
+/// The corpus only depends on the options, so the figures of different commits can be compared.
+
+#include "indexer.h"    /// first because required by Xapian
+#include "configuration.h"
+#include "stats.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QSettings>
+#include <QTemporaryDir>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+#include <sys/stat.h>
+
+namespace {
+const char* const extensions[] = { "txt", "cpp", "h", "pdf", "txt", "mp3", "jpg", "ogg", "o" };   /// mixed, jpg and o aren't wanted
+
+struct corpusType   {
+    std::vector<std::string> words;     /// vocabulary, the lower indexes are the most frequent ones
+    std::mt19937 rng { 20190622 };      /// fixed seed: the same options give the same corpus
+    unsigned int files = 0;             /// files a helper extracts
+    unsigned long long bytes = 0;       /// their size
+};
+
+std::string makeWord(std::mt19937& rng)
+{
+    std::uniform_int_distribution<int> length(2, 10), letter('a', 'z');
+    std::string w(length(rng), ' ');
+    for(auto& c : w)
+        c = static_cast<char>(letter(rng));
+    return w;
+}
+
+/// lines of words with a skewed frequency, roughly like natural language
+std::string makeText(corpusType& corpus, unsigned long long size)
+{
+    std::uniform_real_distribution<double> u(0., 1.);
+    std::string text;
+    text.reserve(size + 16);
+    for(unsigned int column = 0; text.size() < size; ++column)  {
+        const double&& r = u(corpus.rng);
+        text += corpus.words[static_cast<std::size_t>(corpus.words.size() * r * r * r)];
+        text += column % 12 == 11 ? '\n' : ' ';
+    }
+    return text;
+}
+
+void makeDirectories(const std::string& dir, unsigned int depth, std::vector<std::string>& dirs)
+{
+    dirs.push_back(dir);
+    if(!depth)
+        return;
+    for(unsigned int d = 0; d != 3; ++d)   {
+        const std::string sub = dir + "/dir" + std::to_string(d);
+        ::mkdir(sub.c_str(), 0755);
+        makeDirectories(sub, depth - 1, dirs);
+    }
+}
+
+void generatePool( const std::string& root, corpusType& corpus, unsigned int depth
+                 , unsigned int smallFiles, unsigned int hugeFiles, unsigned long long hugeSize )
+{
+    std::vector<std::string> dirs;
+    makeDirectories(root, depth, dirs);
+    std::uniform_int_distribution<unsigned int> smallSize(200, 8000);
+    for(unsigned int f = 0; f != smallFiles; ++f)   {
+        const std::string ext = extensions[f % (sizeof(extensions) / sizeof(*extensions))];
+        const std::string name = dirs[f % dirs.size()] + "/file" + std::to_string(f) + "." + ext;
+        const unsigned int&& size = smallSize(corpus.rng);
+        if(ext == "txt" || ext == "cpp" || ext == "h")  {
+            const std::string&& text = makeText(corpus, size);
+            std::ofstream(name) << text;
+            ++corpus.files;
+            corpus.bytes += text.size();
+        } else  {   /// the stand-ins don't read them: unique contents are enough, so copies aren't shared
+            std::ofstream(name) << ext << ' ' << f << '\n' << std::string(size, '.');
+            if(ext == "pdf" || ext == "mp3" || ext == "ogg")    {
+                ++corpus.files;
+                corpus.bytes += size;
+            }
+        }
+    }
+    for(unsigned int f = 0; f != hugeFiles; ++f)    {
+        std::ofstream ofs(root + "/huge" + std::to_string(f) + ".txt");
+        for(unsigned long long written = 0; written < hugeSize; /* null */) {
+            const std::string&& text = makeText(corpus, 1 << 20);
+            ofs << text;
+            written += text.size();
+            corpus.bytes += text.size();
+        }
+        ++corpus.files;
+    }
+}
+
+/// a shell script that waits then prints the canned text and the file name, like a slow helper would do
+std::string makeHelper(const std::string& dir, const std::string& name, const std::string& text, unsigned int latency)
+{
+    const std::string textFile = dir + "/" + name + ".out"
+                    , script   = dir + "/" + name;
+    std::ofstream(textFile) << text;
+    std::ofstream(script) << "#!/bin/sh\n"
+                          << "sleep " << latency / 1000 << '.' << std::setw(3) << std::setfill('0') << latency % 1000 << '\n'
+                          << "cat '" << textFile << "'\n"
+                          << "echo \"$1\"\n";
+    ::chmod(script.c_str(), 0755);
+    return script;
+}
+
+unsigned long long directorySize(const QString& path)
+{
+    unsigned long long retval = 0;
+    QDirIterator dirIt(path, QDir::Files, QDirIterator::Subdirectories);
+    while(dirIt.hasNext())  {
+        dirIt.next();
+        retval += dirIt.fileInfo().size();
+    }
+    return retval;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setOrganizationName("XDGSearch");
+    QCoreApplication::setApplicationName("indexbench");
+    QCoreApplication::setApplicationVersion(APP_VERSION);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Builds the database of a synthetic pool and reports the indexing throughput.");
+    parser.addHelpOption();
+    const QCommandLineOption filesOption("files", "small files, default 5000", "n", "5000");
+    const QCommandLineOption hugeOption("huge", "huge text files, default 2", "n", "2");
+    const QCommandLineOption hugeSizeOption("huge-size", "size of each huge file, default 32", "MiB", "32");
+    const QCommandLineOption depthOption("depth", "levels of the directory tree, three sub-directories each, default 6", "n", "6");
+    const QCommandLineOption latencyOption("latency", "time each fake helper sleeps, default 20", "ms", "20");
+    const QCommandLineOption outputOption("output", "text each fake helper prints, default 16", "KiB", "16");
+    const QCommandLineOption helpersOption("helpers", "concurrent helpers, 0 means adaptive, default the amount of CPUs", "n"
+                                          , QString::number(std::max(1u, std::thread::hardware_concurrency())));
+    const QCommandLineOption runsOption("runs", "full builds, the median is reported, default 3", "n", "3");
+    const QCommandLineOption positionsOption("positions", "positions of the words: on, off or prefixes, default on", "mode", "on");
+    const QCommandLineOption jsonOption("json", "machine-readable output, a JSON object");
+    for(const auto& o : { filesOption, hugeOption, hugeSizeOption, depthOption, latencyOption, outputOption, helpersOption, runsOption
+                        , positionsOption, jsonOption })
+        parser.addOption(o);
+    parser.process(app);
+
+    const unsigned int smallFiles = parser.value(filesOption).toUInt()
+                     , hugeFiles  = parser.value(hugeOption).toUInt()
+                     , hugeSize   = parser.value(hugeSizeOption).toUInt()
+                     , depth      = parser.value(depthOption).toUInt()
+                     , latency    = parser.value(latencyOption).toUInt()
+                     , output     = parser.value(outputOption).toUInt()
+                     , helpers    = parser.value(helpersOption).toUInt()
+                     , runs       = std::max(1u, parser.value(runsOption).toUInt());
+    const bool json = parser.isSet(jsonOption);
+    const std::string&& positions = parser.value(positionsOption).toStdString();
+
+    QTemporaryDir tempDir;
+    if(!tempDir.isValid())
+        return EXIT_FAILURE;
+    const std::string base = tempDir.path().toStdString()
+                    , root = base + "/pool";
+    ::setenv("XDG_CONFIG_HOME", (base + "/config").c_str(), 1);     /// before the first QSettings: the real settings are untouched
+    ::setenv("XDG_DATA_HOME", (base + "/data").c_str(), 1);         /// the databases, the working directory is set by isFirstRun()
+    ::mkdir(root.c_str(), 0755);
+
+    corpusType corpus;
+    for(unsigned int w = 0; w != 20000; ++w)
+        corpus.words.push_back(makeWord(corpus.rng));
+    generatePool(root, corpus, depth, smallFiles, hugeFiles, static_cast<unsigned long long>(hugeSize) << 20);
+    const std::string&& helperText = makeText(corpus, static_cast<unsigned long long>(output) << 10);
+    std::clog << "generated " << corpus.files << " files to extract, " << corpus.bytes / (1024 * 1024) << " MiB, under " << root << std::endl;
+
+    const XDGSearch::Configuration conf;
+    conf.isFirstRun();      /// creates the working directory and the stop-words
+    conf.initSettings();
+    conf.writeSettings(std::make_tuple(std::string("pstotext"), std::string("pdf")
+                                      , makeHelper(base, "pstotext", helperText, latency), 6u));
+    conf.writeSettings(std::make_tuple(std::string("mediainfo"), std::string("mp3,ogg")
+                                      , makeHelper(base, "mediainfo", helperText, latency), 0u));
+    conf.writeSettings(std::make_tuple( std::string("XDG_DOCUMENTS_DIR"), std::string("bench")
+                                      , std::string("code,pstotext,mediainfo"), root
+                                      , std::string("english"), std::string("english.list")));
+    {
+        QSettings settings;
+        settings.beginGroup("global");
+        settings.setValue("textCacheSize", 0);  /// every run extracts every file
+        settings.setValue("concurrentHelpers", helpers);
+        settings.endGroup();
+        settings.beginGroup("XDG_DOCUMENTS_DIR");
+        settings.setValue("positions", QString::fromStdString(positions));
+        settings.endGroup();
+    }
+
+    std::vector<double> seconds;
+    unsigned int indexed = 0;
+    unsigned long long dbSize = 0;
+    for(unsigned int run = 0; run != runs; ++run)   {
+        QDir(QString("bench")).removeRecursively();     /// a full build each time
+        QFile::remove("bench.journal");
+        XDGSearch::Indexer idx(nullptr, XDGSearch::Pool::DOCUMENTS);
+        idx.setInteractive(true);       /// the background priority would measure the machine load
+
+        const auto&& t0 = std::chrono::steady_clock::now();
+        if(!idx.populateDB())
+            return EXIT_FAILURE;
+        seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+        indexed = idx.getIndexedFiles();
+        dbSize = directorySize("bench");
+        std::clog << "run " << run + 1 << ": " << std::fixed << std::setprecision(3) << seconds.back() << " s" << std::endl;
+    }
+    std::sort(seconds.begin(), seconds.end());
+    const double median = seconds[seconds.size() / 2];
+
+    if(json)
+        std::cout << "{\"version\":" << XDGSearch::jsonString(APP_VERSION)
+                  << ",\"smallFiles\":" << smallFiles << ",\"hugeFiles\":" << hugeFiles << ",\"hugeSizeMiB\":" << hugeSize
+                  << ",\"depth\":" << depth << ",\"latencyMs\":" << latency << ",\"outputKiB\":" << output
+                  << ",\"helpers\":" << helpers << ",\"runs\":" << runs << ",\"positions\":" << XDGSearch::jsonString(positions)
+                  << ",\"files\":" << indexed << ",\"bytes\":" << corpus.bytes
+                  << std::fixed << std::setprecision(3)
+                  << ",\"seconds\":" << median << ",\"fastest\":" << seconds.front() << ",\"slowest\":" << seconds.back()
+                  << ",\"filesPerSecond\":" << indexed / median
+                  << ",\"MBPerSecond\":" << corpus.bytes / median / 1e6
+                  << ",\"peakRSS\":" << XDGSearch::peakRSS() << ",\"dbBytes\":" << dbSize << "}" << std::endl;
+    else    {
+        std::cout << std::fixed << std::setprecision(3)
+                  << "files indexed     " << std::setw(12) << indexed << '\n'
+                  << "seconds (median)  " << std::setw(12) << median << "   fastest " << seconds.front() << ", slowest " << seconds.back() << '\n'
+                  << "files/s           " << std::setw(12) << indexed / median << '\n'
+                  << "MB/s              " << std::setw(12) << corpus.bytes / median / 1e6 << '\n'
+                  << "peak RSS MiB      " << std::setw(12) << XDGSearch::peakRSS() / 1048576. << '\n'
+                  << "database MiB      " << std::setw(12) << dbSize / 1048576. << "   positions " << positions << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
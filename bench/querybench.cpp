@@ -0,0 +1,196 @@
+/* XDGSearch is a XAPIAN based file indexer and search tool.
+
+    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// querybench --pool DOCUMENTS [options] [query log], see --help
+/// replays a query log against a built pool, as the search bar does: enqueryDB() finds the matches, then
+/// composeResult() renders them as html, each step is timed on its own. The log holds a query per line,
+/// when it's not given the queries are drawn from the pool's own terms, the frequent ones more often.
+/// The cold pass evicts the database files from the page cache before each query, the warm pass doesn't.
+
+#include "indexer.h"    /// first because required by Xapian
+#include "configuration.h"
+#include "stats.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QStringList>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+#include <cstdlib>
+#include <cctype>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+using clockType = std::chrono::steady_clock;
+
+/// the raw terms: the prefixed ones, paths, contents hashes and stems, aren't typed by users
+std::vector<std::string> generateQueries(const std::string& DBName, unsigned int amount)
+{
+    std::vector<std::string> terms;
+    std::vector<double> weights;
+    const Xapian::Database db(DBName);
+    for(auto t = db.allterms_begin(); t != db.allterms_end(); ++t)
+        if(!(*t).empty() && !std::isupper(static_cast<unsigned char>((*t)[0])))  {
+            terms.push_back(*t);
+            weights.push_back(t.get_termfreq());
+        }
+    std::vector<std::string> retval;
+    if(terms.empty())
+        return retval;
+    std::mt19937 rng(20190622);     /// fixed seed: the same database gives the same log
+    std::discrete_distribution<std::size_t> pick(weights.begin(), weights.end());
+    std::uniform_int_distribution<int> length(1, 3);
+    for(unsigned int q = 0; q != amount; ++q)   {
+        std::string query = terms[pick(rng)];
+        for(int n = length(rng); --n; /* null */)
+            query += " " + terms[pick(rng)];
+        retval.push_back(query);
+    }
+    return retval;
+}
+
+void evict(const std::string& fileName)
+{
+    const int&& fd = ::open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+        return;
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(fd);
+}
+
+void evictDB(const std::string& DBName)     /// drops the clean pages of the database files, no privilege is needed
+{
+    if(QFileInfo(QString::fromStdString(DBName)).isFile())  {   /// a single file database
+        evict(DBName);
+        return;
+    }
+    QDirIterator dirIt(QString::fromStdString(DBName), QDir::Files, QDirIterator::Subdirectories);
+    while(dirIt.hasNext())
+        evict(dirIt.next().toStdString());
+}
+
+double percentile(std::vector<double>& v, double p)    /// nearest rank
+{
+    if(v.empty())
+        return 0.;
+    std::sort(v.begin(), v.end());
+    const std::size_t&& rank = static_cast<std::size_t>(p / 100. * v.size() + .999999);
+    return v[std::min(v.size(), std::max<std::size_t>(rank, 1)) - 1];
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);       /// no display is needed
+    QCoreApplication::setOrganizationName("XDGSearch");
+    QCoreApplication::setApplicationName("xdgsearch");     /// the settings and the databases of the application
+    QCoreApplication::setApplicationVersion(APP_VERSION);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Replays a query log against a pool's database and reports the search latency.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("log", "a query per line, default drawn from the pool's terms", "[log]");
+    const QCommandLineOption poolOption("pool", "the XDG pool name, e.g. DOCUMENTS", "pool");
+    const QCommandLineOption queriesOption("queries", "queries drawn when no log is given, default 1000", "n", "1000");
+    const QCommandLineOption limitOption("limit", "matches of each query, default 10", "n", "10");
+    const QCommandLineOption jsonOption("json", "machine-readable output, a JSON object");
+    for(const auto& o : { poolOption, queriesOption, limitOption, jsonOption })
+        parser.addOption(o);
+    parser.process(app);
+
+    const XDGSearch::Configuration conf;
+    if(conf.isFirstRun())   {   /// it sets the working directory as well
+        std::cerr << "xdgsearch is not configured yet" << std::endl;
+        return EXIT_FAILURE;
+    }
+    auto p = XDGSearch::Pool::DESKTOP;
+    for(const std::string&& name = parser.value(poolOption).toUpper().toStdString()
+       ; p != XDGSearch::Pool::END && XDGSearch::toXDGKey(p) != name && XDGSearch::toXDGKey(p) != "XDG_" + name + "_DIR"
+       ; ++p)
+        ;
+    if(p == XDGSearch::Pool::END || !conf.isPopulatedDB(p))    {
+        std::cerr << "unknown pool or database not built yet, use e.g.: --pool DOCUMENTS" << std::endl;
+        return EXIT_FAILURE;
+    }
+    const std::string&& DBName = std::get<XDGSearch::LOCALPOOLNAME>(XDGSearch::Configuration(p).enqueryPool());
+
+    std::vector<std::string> queries;
+    if(!parser.positionalArguments().isEmpty()) {
+        std::ifstream ifs(parser.positionalArguments().first().toStdString());
+        for(std::string line; std::getline(ifs, line); /* null */)
+            if(!line.empty())
+                queries.push_back(line);
+    } else
+        queries = generateQueries(DBName, parser.value(queriesOption).toUInt());
+    if(queries.empty()) {
+        std::cerr << "no queries to replay" << std::endl;
+        return EXIT_FAILURE;
+    }
+    const unsigned int limit = std::max(1u, parser.value(limitOption).toUInt());
+
+    const XDGSearch::Indexer idx(nullptr, p);
+    std::vector<double> times[2][2];        /// [cold, warm][match, render], milliseconds
+    unsigned long long resultBytes = 0;     /// keeps the rendering from being optimized away
+    for(int warm = 0; warm != 2; ++warm)
+        for(const auto& q : queries)    {
+            if(!warm)
+                evictDB(DBName);
+            const auto&& t0 = clockType::now();
+            const Xapian::MSet&& matches = idx.enqueryDB(q, limit);
+            const auto&& t1 = clockType::now();
+            resultBytes += idx.composeResult(q, matches).size();
+            const auto&& t2 = clockType::now();
+            times[warm][0].push_back(std::chrono::duration<double, std::milli>(t1 - t0).count());
+            times[warm][1].push_back(std::chrono::duration<double, std::milli>(t2 - t1).count());
+        }
+
+    const char* const passes[] = { "cold", "warm" }, * const steps[] = { "match", "render" };
+    if(parser.isSet(jsonOption))    {
+        std::cout << "{\"version\":" << XDGSearch::jsonString(APP_VERSION)
+                  << ",\"pool\":" << XDGSearch::jsonString(XDGSearch::toXDGKey(p))
+                  << ",\"queries\":" << queries.size() << ",\"limit\":" << limit
+                  << std::fixed << std::setprecision(3);
+        for(int warm = 0; warm != 2; ++warm)
+            for(int step = 0; step != 2; ++step)
+                std::cout << ",\"" << passes[warm] << '_' << steps[step] << "\":{"
+                          << "\"p50\":" << percentile(times[warm][step], 50)
+                          << ",\"p95\":" << percentile(times[warm][step], 95)
+                          << ",\"p99\":" << percentile(times[warm][step], 99) << "}";
+        std::cout << "}" << std::endl;
+    } else  {
+        std::cout << queries.size() << " queries, " << limit << " matches each, " << resultBytes / queries.size() / 2
+                  << " bytes of html on average\n"
+                  << std::left << std::setw(16) << "ms" << std::right
+                  << std::setw(10) << "p50" << std::setw(10) << "p95" << std::setw(10) << "p99" << '\n'
+                  << std::fixed << std::setprecision(3);
+        for(int warm = 0; warm != 2; ++warm)
+            for(int step = 0; step != 2; ++step)
+                std::cout << std::left << std::setw(16) << std::string(passes[warm]) + " " + steps[step] << std::right
+                          << std::setw(10) << percentile(times[warm][step], 50)
+                          << std::setw(10) << percentile(times[warm][step], 95)
+                          << std::setw(10) << percentile(times[warm][step], 99) << '\n';
+        std::cout << std::flush;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,442 @@
+/* XDGSearch is a XAPIAN based file indexer and search tool.
+
+    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// textbench [filter]
+/// microbenchmarks of the text handling hot spots: the paragraph splitter of indexDocuments(), the html escaping,
+/// the highlighting of the sought terms and the composing of the lines of composeResult(). The current code is
+/// reproduced as "baseline" next to the alternatives, on long lines, many short lines and dense term hits.
+/// Before timing, each alternative is checked against the baseline on every input, a mismatch fails the run.
+/// Only the routines whose name contains filter are run, e.g.: textbench escape
+
+#include "chunker.h"
+#include "markup.h"
+#include <QCoreApplication>
+#include <QString>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <new>
+
+std::size_t allocationsCount = 0;   /// heap allocations so far, the splitters are compared by their amount per paragraph
+
+void* operator new(std::size_t size)
+{
+    ++allocationsCount;
+    if(void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+namespace {
+using clockType = std::chrono::steady_clock;
+using storeType = std::function<void(const char*, std::size_t)>;   /// receives each paragraph
+
+const unsigned int granularity = 6;                 /// lines of a paragraph, as the default helpers
+const std::string soughtTerms = "xapian Index";     /// as typed in the search bar
+const char* const spanOpen = "<span style=\" font-weight:600;\">";
+const char* const lineOpen = "<p style=\" margin-top:0px; margin-bottom:0px; margin-left:0px; margin-right:0px; -qt-block-indent:0; text-indent:0px;\">";
+
+volatile std::size_t sink;      /// keeps the results from being optimized away
+
+/// ---- inputs ----------------------------------------------------------------------------------------------
+
+struct inputType {
+    const char* name;
+    std::string text;
+};
+
+std::string makeInput(std::mt19937& rng, std::size_t size, std::size_t lineLength, unsigned int hitEvery)
+{
+    static const char* const words[] = { "the", "database", "of", "R&D", "pool", "helpers", "a<b", "paragraph", "file"
+                                       , "text", "and", "search", "x>y", "document", "term", "query", "stemming" };
+    static const char* const hits[] = { "xapian", "Xapian", "XAPIAN", "index", "Index", "xapian index", "xapian_index" };
+    std::uniform_int_distribution<std::size_t> word(0, sizeof(words) / sizeof(*words) - 1)
+                                              , hit(0, sizeof(hits) / sizeof(*hits) - 1)
+                                              , blank(0, 9);
+    std::string text;
+    for(std::size_t column = 0, n = 0; text.size() < size; ++n)    {
+        const std::string w = hitEvery && n % hitEvery == 0 ? hits[hit(rng)] : words[word(rng)];
+        text += w;
+        column += w.size() + 1;
+        if(column < lineLength)
+            text += ' ';
+        else    {
+            text += blank(rng) ? "\n" : "\n\n";     /// some empty lines, the splitter skips them
+            column = 0;
+        }
+    }
+    return text;
+}
+
+/// ---- paragraph splitter: the inner loop of indexDocuments() ----------------------------------------------
+
+void splitBaseline(const std::string& output, const storeType& store)
+{
+    unsigned int linescounter = 0;
+    std::istringstream issCmdOut(output);
+    for(std::string line, paragraph; ! issCmdOut.eof() ; /* null */ ) {
+        getline(issCmdOut, line);
+        if(!issCmdOut.eof() && line.empty())
+            continue;
+        if(!paragraph.empty())
+            paragraph += '\n';
+        paragraph += line;
+        ++linescounter;
+        if (issCmdOut.eof() || (linescounter == granularity)) {
+            store(paragraph.data(), paragraph.size());
+            paragraph.clear();
+            linescounter = 0;
+        }
+    }
+}
+
+/// std::string::find and a paragraph buffer reused for the whole output
+void splitFind(const std::string& output, const storeType& store)
+{
+    std::string paragraph;
+    unsigned int lines = 0;
+    for(std::size_t pos = 0; pos < output.size(); /* null */)  {
+        std::size_t end = output.find('\n', pos);
+        if(end == std::string::npos)
+            end = output.size();
+        if(end != pos)  {
+            if(!paragraph.empty())
+                paragraph += '\n';
+            paragraph.append(output, pos, end - pos);
+            if(++lines == granularity)  {
+                store(paragraph.data(), paragraph.size());
+                paragraph.clear();
+                lines = 0;
+            }
+        }
+        pos = end + 1;
+    }
+    if(!paragraph.empty())
+        store(paragraph.data(), paragraph.size());
+}
+
+/// the chunker of indexDocuments(): slices of the output, a buffer reused when empty lines are skipped inside a paragraph
+void splitChunker(const std::string& output, const storeType& store)
+{
+    XDGSearch::Chunker chunker(output, granularity);
+    while(chunker.next())
+        store(chunker.data(), chunker.size());
+}
+
+/// ---- html escaping of composeResult() --------------------------------------------------------------------
+
+std::string escapeBaseline(const std::string& s)
+{
+    QString documentText = QString::fromStdString(s);
+    documentText.replace("&","&amp;");
+    documentText.replace("<","&lt;");
+    documentText.replace(">","&gt;");
+    return documentText.toStdString();
+}
+
+std::string escapeSwitch(const std::string& s)
+{
+    std::string retval;
+    retval.reserve(s.size() + s.size() / 16);
+    for(const char c : s)
+        switch(c)   {
+            case '&' : retval += "&amp;"; break;
+            case '<' : retval += "&lt;";  break;
+            case '>' : retval += "&gt;";  break;
+            default  : retval += c;
+        }
+    return retval;
+}
+
+/// appends the runs between reserved characters at once
+std::string escapeRuns(const std::string& s)
+{
+    std::string retval;
+    retval.reserve(s.size() + s.size() / 16);
+    for(std::size_t pos = 0; pos < s.size(); /* null */)    {
+        const std::size_t&& next = s.find_first_of("&<>", pos);
+        if(next == std::string::npos)   {
+            retval.append(s, pos, std::string::npos);
+            break;
+        }
+        retval.append(s, pos, next - pos);
+        retval += s[next] == '&' ? "&amp;" : s[next] == '<' ? "&lt;" : "&gt;";
+        pos = next + 1;
+    }
+    return retval;
+}
+
+/// the escaping of composeResult(): the runs are found 16 or 32 bytes at a time
+std::string escapeVector(const std::string& s)
+{
+    return XDGSearch::escapeHtml(s);
+}
+
+/// ---- highlighting of the sought terms ----------------------------------------------------------------------
+
+std::string highlightBaseline(const std::string& s)
+{
+    QString documentText = QString::fromStdString(s);
+    std::istringstream iss(soughtTerms);
+    for(std::string term, term1; iss >> term; /* null */)   {
+        term1 = term;
+        if ( ! iss.eof())
+            term += " ";
+        for(int pos = documentText.indexOf(QString::fromStdString(term), 0, Qt::CaseInsensitive); pos != -1; /* null */)  {
+            documentText.insert(pos, spanOpen);
+            pos = documentText.indexOf(QString::fromStdString(term), pos, Qt::CaseInsensitive);
+            pos += term.size();
+            documentText.insert(pos, "</span>");
+            ++pos;
+            pos = documentText.indexOf(QString::fromStdString(term), pos, Qt::CaseInsensitive);
+        }
+        if ( ! iss.eof())
+            term1 += "_";
+        for(int pos = documentText.indexOf(QString::fromStdString(term1), 0, Qt::CaseInsensitive); pos != -1; /* null */) {
+            documentText.insert(pos, spanOpen);
+            pos = documentText.indexOf(QString::fromStdString(term1), pos, Qt::CaseInsensitive);
+            pos += term1.size();
+            documentText.insert(pos, "</span>");
+            ++pos;
+            pos = documentText.indexOf(QString::fromStdString(term1), pos, Qt::CaseInsensitive);
+        }
+    }
+    return documentText.toStdString();
+}
+
+/// a single pass over the text: at each position the longest sought variant matching, ASCII case insensitive
+std::string highlightOnePass(const std::string& s)
+{
+    std::vector<std::string> variants;
+    std::istringstream iss(soughtTerms);
+    for(std::string term; iss >> term; /* null */)  {
+        std::transform(term.begin(), term.end(), term.begin(), ::tolower);
+        if(iss.eof())
+            variants.push_back(term);
+        else    {
+            variants.push_back(term + " ");
+            variants.push_back(term + "_");
+        }
+    }
+    std::string retval;
+    retval.reserve(s.size() + s.size() / 8);
+    for(std::size_t pos = 0; pos < s.size(); /* null */)    {
+        std::size_t matched = 0;
+        for(const auto& v : variants)
+            if(v.size() > matched && s.size() - pos >= v.size()
+               && std::equal(v.begin(), v.end(), s.begin() + pos, [] (char a, char b) { return a == ::tolower(static_cast<unsigned char>(b)); }))
+                matched = v.size();
+        if(matched) {
+            retval += spanOpen;
+            retval.append(s, pos, matched);
+            retval += "</span>";
+            pos += matched;
+        } else
+            retval += s[pos++];
+    }
+    return retval;
+}
+
+/// the highlighting of composeResult(): the candidates are found 16 or 32 bytes at a time
+std::string highlightVector(const std::string& s)
+{
+    std::vector<std::string> sought;
+    std::istringstream iss(soughtTerms);
+    for(std::string term; iss >> term; /* null */)
+        if(iss.eof())
+            sought.push_back(term);
+        else    {
+            sought.push_back(term + " ");
+            sought.push_back(term + "_");
+        }
+    return XDGSearch::highlightTerms(s, XDGSearch::TermScanner(sought), spanOpen, "</span>");
+}
+
+/// ---- the lines of a document as html paragraphs -----------------------------------------------------------
+
+std::string composeBaseline(const std::string& s)
+{
+    std::string paragraphDocument;
+    std::istringstream iss(s);
+    for(std::string line; std::getline(iss, line); /* null */)
+        paragraphDocument += lineOpen + line + "</p>";
+    return paragraphDocument;
+}
+
+std::string composeAppend(const std::string& s)
+{
+    static const std::size_t lineOpenSize = std::strlen(lineOpen);
+    std::string retval;
+    retval.reserve(s.size() + (lineOpenSize + 4) * (std::count(s.begin(), s.end(), '\n') + 1));
+    for(std::size_t pos = 0; pos < s.size(); /* null */)    {
+        std::size_t end = s.find('\n', pos);
+        if(end == std::string::npos)
+            end = s.size();
+        retval.append(lineOpen, lineOpenSize).append(s, pos, end - pos).append("</p>", 4);
+        pos = end + 1;
+    }
+    return retval;
+}
+
+/// ---- harness -------------------------------------------------------------------------------------------------
+
+std::string stripTags(const std::string& s)
+{
+    std::string retval;
+    for(std::size_t pos = 0; pos < s.size(); ++pos)
+        if(s[pos] == '<')
+            pos = s.find('>', pos);
+        else
+            retval += s[pos];
+    return retval;
+}
+
+/// a paragraph of the baseline isn't stored if it's empty, and its trailing new line is dropped by the alternatives
+std::vector<std::string> paragraphs(const std::function<void(const std::string&, const storeType&)>& split, const std::string& s)
+{
+    std::vector<std::string> retval;
+    split(s, [&] (const char* p, std::size_t n) {
+        std::string paragraph(p, n);
+        if(!paragraph.empty() && paragraph.back() == '\n')
+            paragraph.pop_back();
+        if(!paragraph.empty())
+            retval.push_back(paragraph);
+    });
+    return retval;
+}
+
+/// repeats f until a batch lasts at least 20 ms, the best of 5 batches is reported
+void measure(const char* routine, const char* variant, const inputType& input, const std::function<std::size_t()>& f)
+{
+    std::size_t iterations = 1;
+    for(;; iterations *= 2) {
+        const auto&& t0 = clockType::now();
+        for(std::size_t i = 0; i != iterations; ++i)
+            sink = sink + f();
+        if(clockType::now() - t0 >= std::chrono::milliseconds(20))
+            break;
+    }
+    double best = 1e300;
+    for(int batch = 0; batch != 5; ++batch) {
+        const auto&& t0 = clockType::now();
+        for(std::size_t i = 0; i != iterations; ++i)
+            sink = sink + f();
+        best = std::min(best, std::chrono::duration<double, std::micro>(clockType::now() - t0).count() / iterations);
+    }
+    std::cout << std::left << std::setw(10) << routine << std::setw(14) << input.name << std::setw(12) << variant
+              << std::right << std::fixed << std::setprecision(1) << std::setw(12) << best << " us"
+              << std::setw(10) << input.text.size() / best << " MB/s" << std::endl;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    const std::string filter = argc > 1 ? argv[1] : "";
+    const auto wanted = [&] (const char* routine) { return std::string(routine).find(filter) != std::string::npos; };
+
+    std::mt19937 rng(20190622);     /// fixed seed: the same inputs at each run
+    const std::vector<inputType> inputs {
+          { "long lines",  makeInput(rng, 256 * 1024, 4000, 0) }
+        , { "short lines", makeInput(rng, 256 * 1024, 12, 0) }
+        , { "dense hits",  makeInput(rng, 256 * 1024, 80, 3) }
+    };
+    std::vector<inputType> escapedInputs;   /// composeResult() highlights the text once escaped
+    for(const auto& input : inputs)
+        escapedInputs.push_back({ input.name, escapeSwitch(input.text) });
+    const inputType paragraph { "paragraph", escapedInputs[2].text.substr(0, 600) };    /// about 6 lines, as stored in the database
+
+    using splitterType = std::pair<const char*, void(*)(const std::string&, const storeType&)>;
+    using transformType = std::pair<const char*, std::string(*)(const std::string&)>;
+    const std::vector<splitterType> splitters { { "baseline", splitBaseline }, { "find", splitFind }, { "chunker", splitChunker } };
+    const std::vector<transformType> escapers { { "baseline", escapeBaseline }, { "switch", escapeSwitch }, { "runs", escapeRuns }, { "vector", escapeVector } };
+    const std::vector<transformType> highlighters { { "baseline", highlightBaseline }, { "one pass", highlightOnePass }, { "vector", highlightVector } };
+    const std::vector<transformType> composers { { "baseline", composeBaseline }, { "append", composeAppend } };
+
+    bool same = true;
+    for(const auto& input : inputs) {
+        const auto&& expected = paragraphs(splitBaseline, input.text);
+        for(const auto& s : splitters)
+            if(paragraphs(s.second, input.text) != expected)    {
+                std::cerr << "split " << s.first << " differs on " << input.name << std::endl;
+                same = false;
+            }
+        for(const auto& list : { &escapers, &composers })
+            for(const auto& t : *list)
+                if(t.second(input.text) != list ->front().second(input.text))   {
+                    std::cerr << t.first << " differs on " << input.name << std::endl;
+                    same = false;
+                }
+        const std::string&& escaped = escapeSwitch(input.text);
+        for(const auto& t : highlighters)   /// the baseline may nest the spans: only the text must be the same
+            if(stripTags(t.second(escaped)) != escaped) {
+                std::cerr << "highlight " << t.first << " alters the text of " << input.name << std::endl;
+                same = false;
+            }
+        if(highlightVector(escaped) != highlightOnePass(escaped))  {
+            std::cerr << "highlight vector differs from one pass on " << input.name << std::endl;
+            same = false;
+        }
+    }
+    if(!same)
+        return EXIT_FAILURE;
+    std::cout << "vector extension: " << XDGSearch::vectorExtension() << std::endl;
+
+    for(const auto& input : inputs) {
+        if(wanted("split"))
+            for(const auto& s : splitters)  {
+                measure("split", s.first, input, [&] () {
+                    std::size_t n = 0;
+                    s.second(input.text, [&] (const char* p, std::size_t len) { n += len + static_cast<unsigned char>(*p); });
+                    return n;
+                });
+                std::size_t stored = 0;
+                const std::size_t before = allocationsCount;
+                s.second(input.text, [&] (const char*, std::size_t) { ++stored; });
+                std::cout << std::setw(48) << std::fixed << std::setprecision(3)
+                          << double(allocationsCount - before) / std::max<std::size_t>(stored, 1) << " allocations/paragraph" << std::endl;
+            }
+        if(wanted("escape"))
+            for(const auto& t : escapers)
+                measure("escape", t.first, input, [&] () { return t.second(input.text).size(); });
+        if(wanted("compose"))
+            for(const auto& t : composers)
+                measure("compose", t.first, input, [&] () { return t.second(input.text).size(); });
+    }
+    if(wanted("highlight"))
+        for(const auto& input : escapedInputs)
+            for(const auto& t : highlighters)
+                measure("highlight", t.first, input, [&] () { return t.second(input.text).size(); });
+    if(wanted("highlight"))     /// composeResult() highlights one paragraph at a time
+        for(const auto& t : highlighters)
+            measure("highlight", t.first, paragraph, [&] () { return t.second(paragraph.text).size(); });
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,117 @@
+/* XDGSearch is a XAPIAN based file indexer and search tool.
+
+    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// walkerbench [depth [fanout [files per directory]]]
+/// generates a deep tree under a temporary directory then walks it with QDirIterator,
+/// as populateDB did, and with the Walker crawling with one and with many threads
+
+#include "walker.h"
+#include <QCoreApplication>
+#include <QDirIterator>
+#include <QTemporaryDir>
+#include <QStringList>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cstdlib>
+#include <sys/stat.h>
+
+namespace {
+const char* const extensions[] = { "txt", "pdf", "odt", "jpg", "mp3", "cpp", "h", "o" };    /// mixed, the last one isn't wanted
+
+unsigned int generateTree(const std::string& dir, unsigned int depth, unsigned int fanout, unsigned int files)
+{
+    unsigned int retval = 0;
+    for(unsigned int f = 0; f != files; ++f, ++retval)
+        std::ofstream(dir + "/file" + std::to_string(f) + "." + extensions[f % (sizeof(extensions) / sizeof(*extensions))]) << f << '\n';
+    if(!depth)
+        return retval;
+    for(unsigned int d = 0; d != fanout; ++d)   {
+        const std::string sub = dir + "/dir" + std::to_string(d);
+        ::mkdir(sub.c_str(), 0755);
+        retval += generateTree(sub, depth - 1, fanout, files);
+    }
+    return retval;
+}
+
+template<typename F>
+void measure(const char* name, F walk)
+{
+    const auto t1 = std::chrono::steady_clock::now();
+    const unsigned int found = walk();
+    const auto t2 = std::chrono::steady_clock::now();
+    const double ms = std::chrono::duration<double, std::milli>(t2 - t1).count();
+    std::cout << std::left << std::setw(24) << name
+              << std::right << std::setw(10) << found << " files "
+              << std::setw(10) << std::fixed << std::setprecision(1) << ms << " ms "
+              << std::setw(12) << std::setprecision(0) << found / ms * 1000. << " files/s" << std::endl;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    const unsigned int depth  = argc > 1 ? std::atoi(argv[1]) : 6
+                     , fanout = argc > 2 ? std::atoi(argv[2]) : 4
+                     , files  = argc > 3 ? std::atoi(argv[3]) : 20;
+
+    QTemporaryDir tempDir;
+    if(!tempDir.isValid())
+        return EXIT_FAILURE;
+    const std::string root = tempDir.path().toStdString();
+    std::cout << "generated " << generateTree(root, depth, fanout, files) << " files, depth " << depth
+              << ", fanout " << fanout << " under " << root << std::endl;
+
+    const std::vector<std::string> helpersExtensions { "txt,cpp,h", "pdf", "odt,ods", "jpg,jpeg,png", "mp3,ogg" };
+    const XDGSearch::walkerType rules("", 0, 0, true);
+
+    for(int run = 0; run != 2; ++run)   {   /// the tree was just written: even the first pass finds it cached
+        std::cout << (run ? "second pass:" : "first pass:") << std::endl;
+        measure("QDirIterator", [&] () {    /// one walk for each helper as populateDB did
+            unsigned int n = 0;
+            for(const auto& ext : helpersExtensions)    {
+                QStringList filter;
+                std::istringstream iss(ext);
+                for(std::string e; std::getline(iss, e, ','); /* null */)
+                    filter << QString::fromStdString("*." + e);
+                QDirIterator dirIt( QString::fromStdString(root), filter, QDir::Files
+                                  , QDirIterator::Subdirectories | QDirIterator::FollowSymlinks);
+                for(; dirIt.hasNext(); ++n)
+                    dirIt.next();
+            }
+            return n;
+        });
+        measure("Walker, 1 thread", [&] () {
+            XDGSearch::Walker w(root, helpersExtensions, rules, 1);
+            unsigned int n = 0;
+            for(; w.hasNext(); ++n)
+                w.next();
+            return n;
+        });
+        measure("Walker, auto threads", [&] () {
+            XDGSearch::Walker w(root, helpersExtensions, rules);
+            unsigned int n = 0;
+            for(; w.hasNext(); ++n)
+                w.next();
+            return n;
+        });
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,40 @@
+# XDGSearch is a XAPIAN based file indexer and search tool.
+#
+#    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+#
+#    This program is free software: you can redistribute it and/or modify
+#    it under the terms of the GNU General Public License as published by
+#    the Free Software Foundation, either version 3 of the License, or
+#    (at your option) any later version.
+#
+#    This program is distributed in the hope that it will be useful,
+#    but WITHOUT ANY WARRANTY; without even the implied warranty of
+#    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#    GNU General Public License for more details.
+#
+#    You should have received a copy of the GNU General Public License
+#    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#-------------------------------------------------
+#
+# Compares the pool Walker against QDirIterator on a generated deep tree
+#
+#-------------------------------------------------
+
+QT      += core
+QT      -= gui
+CONFIG   += c++11 console
+CONFIG   -= app_bundle
+
+TARGET = walkerbench
+TEMPLATE = app
+INCLUDEPATH += ..
+LIBS     += -pthread
+
+SOURCES += walkerbench.cpp \
+    ../walker.cpp \
+    ../journal.cpp
+
+HEADERS += ../walker.h \
+    ../journal.h
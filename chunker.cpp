@@ -0,0 +1,76 @@
+/* XDGSearch is a XAPIAN based file indexer and search tool.
+
+    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "chunker.h"
+#include <cstring>
+
+XDGSearch::Chunker::Chunker(const std::string& text, unsigned int granularity) :
+      p(text.data())
+    , end(text.data() + text.size())
+    , lines(granularity ? granularity : 15)     /// 0 means documents length of 15 lines
+    , firstOnly(!granularity)
+    , done(false)
+    , paragraph(nullptr)
+    , length(0)
+{
+}
+
+bool XDGSearch::Chunker::next()
+{
+    if(done)
+        return false;
+    buffer.clear();
+    const char* sliceBegin = nullptr;   /// the paragraph so far, while it's contiguous in the text
+    const char* sliceEnd = nullptr;
+    unsigned int n = 0;
+    while(p != end && n != lines)   {
+        const char* nl = static_cast<const char*>(std::memchr(p, '\n', end - p));  /// vectorized by the C library
+        if(!nl)
+            nl = end;
+        if(nl != p) {                   /// empty lines are skipped
+            if(sliceBegin && sliceEnd + 1 == p)     /// the line next to the slice
+                sliceEnd = nl;
+            else if(!sliceBegin && buffer.empty())  {   /// the first line of the paragraph
+                sliceBegin = p;
+                sliceEnd = nl;
+            } else  {                   /// an empty line was skipped: the lines are gathered into the buffer
+                if(sliceBegin)  {
+                    buffer.assign(sliceBegin, sliceEnd);
+                    sliceBegin = nullptr;
+                }
+                buffer += '\n';
+                buffer.append(p, nl);
+            }
+            ++n;
+        }
+        p = nl == end ? end : nl + 1;
+    }
+    if(!n)  {
+        done = true;
+        return false;
+    }
+    if(sliceBegin)  {
+        paragraph = sliceBegin;
+        length = sliceEnd - sliceBegin;
+    } else  {
+        paragraph = buffer.data();
+        length = buffer.size();
+    }
+    done = firstOnly;
+    return true;
+}
@@ -0,0 +1,53 @@
+/* XDGSearch is a XAPIAN based file indexer and search tool.
+
+    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef XDGSEARCH_INCLUDED_CHUNKER_H
+#define XDGSEARCH_INCLUDED_CHUNKER_H
+
+#include <string>
+#include <cstddef>
+
+namespace XDGSearch {
+class Chunker;              /// splits a helper output into the paragraphs stored as documents
+}
+
+/// A paragraph is made of granularity lines joined by new lines, empty lines are skipped. The text is scanned with
+/// memchr() and a paragraph with no empty line inside is a slice of the text: nothing is copied. Otherwise its
+/// lines are gathered into a buffer reused by all the paragraphs. Granularity 0 yields only the first paragraph,
+/// of 15 lines. A slice, like the buffer, is valid until the next call to next().
+class XDGSearch::Chunker final {
+public:
+    Chunker(const std::string&, unsigned int);  /// text, it must outlive the chunker, and lines of each paragraph
+    Chunker(Chunker&&) = delete;
+    Chunker& operator=(Chunker&&) = delete;
+    ~Chunker() = default;
+    bool next();                                /// moves to the next paragraph, false when no one is left
+    const char* data() const                    { return paragraph; }
+    std::size_t size() const                    { return length; }
+private:
+    const char* p;                  /// the first character not scanned yet
+    const char* const end;
+    const unsigned int lines;
+    const bool firstOnly;
+    bool done;
+    std::string buffer;             /// the paragraphs that aren't a slice of the text
+    const char* paragraph;
+    std::size_t length;
+};
+
+#endif /// XDGSEARCH_INCLUDED_CHUNKER_H
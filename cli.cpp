@@ -0,0 +1,222 @@
+/* XDGSearch is a XAPIAN based file indexer and search tool.
+
+    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "indexer.h"    /// first because required by Xapian
+#include "cli.h"
+#include "configuration.h"
+#include "stats.h"
+#include "trace.h"
+#include "doctext.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QStringList>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <vector>
+#include <cctype>
+
+namespace {
+using clockType = std::chrono::steady_clock;
+
+double secondsSince(const clockType::time_point& t0)
+{
+    return std::chrono::duration<double>(clockType::now() - t0).count();
+}
+
+std::string toUpper(std::string s)
+{
+    for(auto& c : s)
+        c = std::toupper(static_cast<unsigned char>(c));
+    return s;
+}
+
+/// accepts the XDG key, the XDG key without "XDG_" and "_DIR", e.g.: DOCUMENTS, or the local pool name
+bool poolFromName(const std::string& name, std::vector<XDGSearch::Pool>& selected)
+{
+    const std::string&& upper = toUpper(name);
+    for(auto p = XDGSearch::Pool::DESKTOP; p != XDGSearch::Pool::END; ++p)   {
+        const XDGSearch::Configuration conf(p);
+        const auto&& pt = conf.enqueryPool();
+        const std::string&& key = XDGSearch::toXDGKey(p);
+        if(std::get<XDGSearch::LOCALPOOLNAME>(pt).empty())     /// not configured
+            continue;
+        if(  upper == "ALL"
+          || upper == key
+          || "XDG_" + upper + "_DIR" == key
+          || name == std::get<XDGSearch::LOCALPOOLNAME>(pt) )
+            selected.push_back(p);
+    }
+    return !selected.empty();
+}
+
+int indexPools(const std::vector<XDGSearch::Pool>& pools, bool incremental, bool interactive, bool json)
+{
+    int retval = EXIT_SUCCESS;
+    for(const auto& p : pools)  {
+        const XDGSearch::Configuration conf(p);
+        const std::string&& poolName = std::get<XDGSearch::LOCALPOOLNAME>(conf.enqueryPool());
+        XDGSearch::Indexer idx(nullptr, p);
+        idx.setInteractive(interactive);
+
+        const auto&& t0 = clockType::now();
+        const bool&& done = idx.populateDB(incremental);
+        const double&& seconds = secondsSince(t0);
+        if(!done)
+            retval = EXIT_FAILURE;
+
+        if(json)
+            std::cout << "{\"pool\":" << XDGSearch::jsonString(XDGSearch::toXDGKey(p))
+                      << ",\"name\":" << XDGSearch::jsonString(poolName)
+                      << ",\"incremental\":" << (incremental ? "true" : "false")
+                      << ",\"status\":\"" << (done ? "done" : "interrupted") << "\""
+                      << ",\"files\":" << idx.getIndexedFiles()
+                      << ",\"priorityApplied\":" << (idx.isPriorityApplied() ? "true" : "false")
+                      << ",\"seconds\":" << std::fixed << std::setprecision(3) << seconds
+                      << ",\"peakRSS\":" << XDGSearch::peakRSS() << "}" << std::endl;
+        else
+            std::cout << poolName << ": " << idx.getIndexedFiles() << " files indexed in "
+                      << std::fixed << std::setprecision(3) << seconds << " s"
+                      << ", peak resident memory " << XDGSearch::peakRSS() / (1024 * 1024) << " MiB"
+                      << (done ? "" : ", interrupted") << std::endl;
+        if(!idx.isPriorityApplied())
+            std::cerr << poolName << ": the system refused the " << (interactive ? "normal" : "background")
+                      << " priority, raising it back needs RLIMIT_NICE or CAP_SYS_NICE" << std::endl;
+    }
+    return retval;
+}
+
+int searchPool(const XDGSearch::Pool& p, const std::string& query, unsigned int limit, bool json)
+{
+    const XDGSearch::Configuration conf(p);
+    if(!conf.isPopulatedDB(p))  {
+        std::cerr << "the database of " << XDGSearch::toXDGKey(p) << " is not built yet, run: xdgsearch index --pool "
+                  << XDGSearch::toXDGKey(p) << std::endl;
+        return EXIT_FAILURE;
+    }
+    const XDGSearch::Indexer idx(nullptr, p);
+
+    const auto&& t0 = clockType::now();
+    const Xapian::MSet&& matches = idx.enqueryDB(query, limit);
+    const double&& seconds = secondsSince(t0);
+
+    if(json)
+        std::cout << "{\"pool\":" << XDGSearch::jsonString(XDGSearch::toXDGKey(p))
+                  << ",\"query\":" << XDGSearch::jsonString(query)
+                  << ",\"seconds\":" << std::fixed << std::setprecision(6) << seconds
+                  << ",\"estimated\":" << matches.get_matches_estimated()
+                  << ",\"results\":[";
+    unsigned int rank = 0;
+    for(auto m = matches.begin(); m != matches.end(); ++m)  {
+        const Xapian::Document&& doc = m.get_document();
+        std::string fileName;
+        for(auto t = doc.termlist_begin(); t != doc.termlist_end(); ++t)    /// the term added with the path of the file
+            if(!(*t).empty() && (*t)[0] == 'P')   {
+                fileName = (*t).substr(1);
+                break;
+            }
+        if(json)
+            std::cout << (rank ? "," : "")
+                      << "{\"rank\":" << rank + 1
+                      << ",\"percent\":" << m.get_percent()
+                      << ",\"file\":" << XDGSearch::jsonString(fileName)
+                      << ",\"text\":" << XDGSearch::jsonString(idx.documentText(doc)) << "}";
+        else    {
+            std::cout << m.get_percent() << "% " << fileName << '\n';
+            std::istringstream issData(idx.documentText(doc));
+            for(std::string line; std::getline(issData, line); /* null */)
+                std::cout << "    " << line << '\n';
+        }
+        ++rank;
+    }
+    if(json)
+        std::cout << "]}" << std::endl;
+    else
+        std::cout << rank << " of about " << matches.get_matches_estimated() << " matches in "
+                  << std::fixed << std::setprecision(6) << seconds << " s" << std::endl;
+    return EXIT_SUCCESS;
+}
+}
+
+bool XDGSearch::isCliCommand(const std::string& arg)
+{
+    return arg == "index" || arg == "search";
+}
+
+int XDGSearch::runCli(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);       /// no display is needed
+    QCoreApplication::setOrganizationName("XDGSearch");
+    QCoreApplication::setApplicationName("xdgsearch");
+    QCoreApplication::setApplicationVersion(APP_VERSION);   /// the version number is stored into xdgsearch.pri file
+    QCommandLineParser parser;
+    parser.setApplicationDescription("XDGSearch is a XAPIAN based file indexer and search tool.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("command", "index: build the databases of the pools, search: query a pool's database");
+    parser.addPositionalArgument("query", "the terms sought, search command only", "[query...]");
+    const QCommandLineOption poolOption("pool", "an XDG pool name like DOCUMENTS, its local name or all (index only)", "pool");
+    const QCommandLineOption incrementalOption("incremental", "index only what changed since the last build");
+    const QCommandLineOption interactiveOption("interactive", "index with normal priority instead of the background one (index only)");
+    const QCommandLineOption traceOption("trace", "record the spans of the indexing steps into a Chrome trace-event file (index only)", "file");
+    const QCommandLineOption jsonOption("json", "machine-readable output, one JSON object for each pool");
+    const QCommandLineOption limitOption("limit", "amount of results to print, default 10", "n", "10");
+    parser.addOption(poolOption);
+    parser.addOption(incrementalOption);
+    parser.addOption(interactiveOption);
+    parser.addOption(traceOption);
+    parser.addOption(jsonOption);
+    parser.addOption(limitOption);
+    parser.process(app);
+
+    const XDGSearch::Configuration conf;
+    if(conf.isFirstRun())   {   /// it sets the working directory as well
+        std::cerr << "xdgsearch is not configured yet, run it once from a desktop session" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const QStringList args = parser.positionalArguments();
+    const std::string command = args.isEmpty() ? std::string() : args.first().toStdString();
+    std::vector<XDGSearch::Pool> pools;
+    if(!parser.isSet(poolOption) || !poolFromName(parser.value(poolOption).toStdString(), pools))  {
+        std::cerr << "unknown or unconfigured pool, use e.g.: --pool DOCUMENTS" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if(command == "index")  {
+        if(parser.isSet(traceOption))
+            XDGSearch::Trace::start();
+        const int&& retval = indexPools(pools, parser.isSet(incrementalOption), parser.isSet(interactiveOption), parser.isSet(jsonOption));
+        if(parser.isSet(traceOption) && !XDGSearch::Trace::save(parser.value(traceOption).toStdString()))   {
+            std::cerr << "can't write the trace file " << parser.value(traceOption).toStdString() << std::endl;
+            return EXIT_FAILURE;
+        }
+        return retval;
+    }
+
+    QStringList terms = args;
+    terms.removeFirst();
+    if(terms.isEmpty() || pools.size() != 1)    {
+        std::cerr << "search needs a single pool and the terms sought" << std::endl;
+        return EXIT_FAILURE;
+    }
+    bool ok = false;
+    const unsigned int&& limit = parser.value(limitOption).toUInt(&ok);
+    return searchPool(pools.front(), terms.join(" ").toStdString(), ok && limit ? limit : 10, parser.isSet(jsonOption));
+}
@@ -0,0 +1,32 @@
+/* XDGSearch is a XAPIAN based file indexer and search tool.
+
+    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef XDGSEARCH_INCLUDED_CLI_H
+#define XDGSEARCH_INCLUDED_CLI_H
+
+#include <string>
+
+/// Headless subcommands, they need neither a display nor the widgets:
+///     xdgsearch index --pool DOCUMENTS [--incremental] [--interactive] [--trace file] [--json]
+///     xdgsearch search --pool DOCUMENTS [--json] [--limit n] QUERY
+namespace XDGSearch {
+bool isCliCommand(const std::string&);      /// true if the first argument is a subcommand
+int runCli(int, char*[]);                   /// parses the command line and runs the subcommand, it returns the exit status
+}
+
+#endif /// XDGSEARCH_INCLUDED_CLI_H
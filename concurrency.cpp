@@ -0,0 +1,133 @@
+/* XDGSearch is a XAPIAN based file indexer and search tool.
+
+    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "concurrency.h"
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <thread>
+#include <cstdlib>
+
+namespace {
+const std::chrono::seconds period(3);       /// long enough for a few extractions to be stored at any concurrency
+const double cpuSaturation = 25.;           /// percent of the period some task waited for a CPU
+const double ioStallRise = 5.;              /// percent of the period more spent waiting for I/O: not noise
+const double throughputGain = 1.05;         /// the files per second a helper more must bring, at least
+const double loadSaturation = 1.5;          /// runnable tasks per CPU, only without PSI
+const double throughputDrop = .9;           /// an increase followed by less than this share of the throughput is undone
+
+unsigned int cpus()
+{
+    const unsigned int&& n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+}
+}
+
+XDGSearch::Concurrency::Concurrency(const std::string& n, unsigned int fixed) :
+      name(n)
+    , adaptive(fixed == 0)
+    , minimum(1)
+    , maximum(adaptive ? cpus() * 4 : fixed)    /// helpers spend time waiting on the disk as well
+    , current(adaptive ? cpus() : fixed)
+    , completedInPeriod(0)
+    , periodStart(clockType::now())
+    , lastThroughput(0)
+    , grew(false)
+    , holdOff(false)
+    , cpuStall(0)
+    , ioStall(0)
+    , psi(adaptive && readStall("/proc/pressure/cpu", cpuStall) && readStall("/proc/pressure/io", ioStall))
+    , lastIoShare(0)
+{
+}
+
+void XDGSearch::Concurrency::completed()
+{
+    if(!adaptive)
+        return;
+    ++completedInPeriod;
+    const auto&& now = clockType::now();
+    const auto&& elapsed = now - periodStart;
+    if(elapsed < period)
+        return;
+    const double&& seconds = std::chrono::duration<double>(elapsed).count();
+    adjust(completedInPeriod / seconds, seconds);
+    completedInPeriod = 0;
+    periodStart = now;
+}
+
+bool XDGSearch::Concurrency::readStall(const char* fileName, unsigned long long& total)
+{
+    std::ifstream ifs(fileName);
+    std::string kind, field;    /// first line: "some avg10=1.23 avg60=... avg300=... total=..."
+    if(!(ifs >> kind) || kind != "some")
+        return false;
+    while(ifs >> field)
+        if(field.compare(0, 6, "total=") == 0)  {   /// the averages decay over 10 s and more: they lag behind a period
+            total = std::strtoull(field.c_str() + 6, nullptr, 10);
+            return true;
+        }
+    return false;
+}
+
+void XDGSearch::Concurrency::adjust(double throughput, double seconds)
+{
+    double cpuShare = 0, ioShare = 0, load = 0;
+    unsigned long long cpuNow, ioNow;
+    if(psi && readStall("/proc/pressure/cpu", cpuNow) && readStall("/proc/pressure/io", ioNow))  {
+        cpuShare = (cpuNow - cpuStall) / (seconds * 1e4);   /// microseconds to percent of the period
+        ioShare = (ioNow - ioStall) / (seconds * 1e4);
+        cpuStall = cpuNow;
+        ioStall = ioNow;
+    } else if(::getloadavg(&load, 1) == 1)
+        load /= cpus();
+    const bool&& moreIoStall = psi && ioShare > lastIoShare + ioStallRise;
+
+    const unsigned int previous = current;
+    std::string reason;
+    if(psi ? cpuShare > cpuSaturation : load > loadSaturation)  {
+        current = std::max(minimum, current / 2);
+        reason = "machine saturated";
+    } else if(grew && moreIoStall && throughput < lastThroughput * throughputGain)  {
+        current = std::max(minimum, current - 1);
+        reason = "disk saturated, the last helper only waited for it";
+    } else if(grew && throughput < lastThroughput * throughputDrop)   {
+        current = std::max(minimum, current - 1);
+        reason = "no gain from the last helper";
+    } else if(!grew && moreIoStall && throughput < lastThroughput * throughputDrop)  {
+        current = std::max(minimum, current / 2);
+        reason = "disk saturated";
+    } else if(!holdOff && current < maximum)    {
+        ++current;
+        reason = "room left";
+    }
+    grew = current > previous;
+    holdOff = current < previous;
+    lastThroughput = throughput;
+    lastIoShare = ioShare;
+
+    if(current == previous)
+        return;
+    std::clog << name << ": helpers " << previous << " -> " << current << ", " << reason << " ("
+              << std::fixed << std::setprecision(1) << throughput << " files/s, ";
+    if(psi)
+        std::clog << "cpu stall " << cpuShare << "%, io stall " << ioShare << "% of the period)" << std::endl;
+    else
+        std::clog << "load " << std::setprecision(2) << load << " per CPU)" << std::endl;
+}
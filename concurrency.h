@@ -0,0 +1,63 @@
+/* XDGSearch is a XAPIAN based file indexer and search tool.
+
+    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef XDGSEARCH_INCLUDED_CONCURRENCY_H
+#define XDGSEARCH_INCLUDED_CONCURRENCY_H
+
+#include <string>
+#include <chrono>
+
+namespace XDGSearch {
+class Concurrency;          /// how many helpers a build runs at once, tuned while the build runs
+}
+
+/// Additive increase, multiplicative decrease: every period the amount of helpers grows by one while the machine
+/// isn't saturated and the files stored per second don't drop. The stall of the period comes from the cumulative
+/// "total" microseconds of /proc/pressure: the CPU is saturated when tasks waited for it a fixed share of the
+/// period, then the helpers are halved; the disk is when the I/O stall grew without more files stored, then the
+/// helper added last is taken back, or the helpers are halved if the throughput fell. Where PSI is missing the load
+/// average tells. No helper is added the period after a decrease, so the build converges to the throughput the
+/// hardware and the other running programs leave instead of oscillating around it.
+class XDGSearch::Concurrency final {
+public:
+    Concurrency(const std::string&, unsigned int);  /// name used by the log, fixed amount of helpers: 0 means adaptive
+    Concurrency(Concurrency&&) = delete;
+    Concurrency& operator=(Concurrency&&) = delete;
+    ~Concurrency() = default;
+    unsigned int limit() const              { return current; }
+    void completed();                       /// an extraction was stored, it may change limit()
+private:
+    using clockType = std::chrono::steady_clock;
+    void adjust(double, double);            /// files per second and seconds of the last period
+    static bool readStall(const char*, unsigned long long&);    /// "some total" microseconds of a /proc/pressure file, false without PSI
+
+    const std::string name;
+    const bool adaptive;
+    const unsigned int minimum, maximum;
+    unsigned int current;
+    unsigned int completedInPeriod;
+    clockType::time_point periodStart;
+    double lastThroughput;
+    bool grew;                              /// the last change was an increase
+    bool holdOff;                           /// the last change was a decrease: it's given a whole period
+    unsigned long long cpuStall, ioStall;   /// cumulative microseconds read at the beginning of the period
+    bool psi;
+    double lastIoShare;                     /// percent of the last period some task waited for I/O
+};
+
+#endif /// XDGSEARCH_INCLUDED_CONCURRENCY_H
@@ -20,6 +20,7 @@
 #include <fstream>
 #include <algorithm>
 #include <QDir>
+#include <QFileInfo>
 #include <QStringList>
 #include <QSettings>
 #include <QStandardPaths>
@@ -140,6 +141,7 @@ void XDGSearch::cfgSources::defaultSettings(const std::string& XDGKeyword)
     std::get<LOCALPOOLNAME>(pools) = "Sources";
     std::get<STEMMING>(pools) = "none";
     std::get<STOPWORDSFILE>(pools) = "none";
+    walker = std::make_tuple("node_modules/,__pycache__/,CMakeFiles/,build/,*.o", 0, 0, true);  /// generated files are not worth indexing
 
     addHelperToPool("code");
 }
@@ -174,6 +176,7 @@ void XDGSearch::ConfigurationBase::defaultSettingsCommonCode(const std::string&
     }
     std::get<STEMMING>(pools) = "none";            /// set stem language to "none"
     std::get<STOPWORDSFILE>(pools) = "none";            /// set stopwords file value to none
+    walker = std::make_tuple("node_modules/,__pycache__/", 0, 0, true);    /// set default walking rules
 }
 
 const std::pair<std::string, std::string> XDGSearch::ConfigurationBase::getXDGKeysDirPath(const std::string& XDGKey)
@@ -349,6 +352,49 @@ const XDGSearch::poolType XDGSearch::ConfigurationBase::enqueryPool()
     return pools;
 }
 
+const XDGSearch::walkerType XDGSearch::ConfigurationBase::enqueryWalker()
+{
+    if(std::get<XDGPOOLNAME>(pools).empty())      /// useful if called for Settings type: none pool
+        return walker;
+
+    settings.beginGroup(QString::fromStdString(std::get<XDGPOOLNAME>(pools)));
+    /// query pool section items in .conf file, when missing the defaults set by defaultSettings() are kept
+    std::get<EXCLUDEPATTERNS>(walker) = settings.value("excludepatterns", QString::fromStdString(std::get<EXCLUDEPATTERNS>(walker))).toString().toStdString();
+    std::get<MAXDEPTH>(walker)        = settings.value("maxdepth"       , std::get<MAXDEPTH>(walker)).toUInt();
+    std::get<MAXFILESIZE>(walker)     = settings.value("maxfilesize"    , std::get<MAXFILESIZE>(walker)).toULongLong();
+    std::get<SKIPHIDDEN>(walker)      = settings.value("skiphidden"     , std::get<SKIPHIDDEN>(walker)).toBool();
+
+    settings.endGroup();
+    return walker;
+}
+
+bool XDGSearch::ConfigurationBase::indexPositions()
+{
+    if(std::get<XDGPOOLNAME>(pools).empty())
+        return true;
+
+    settings.beginGroup(QString::fromStdString(std::get<XDGPOOLNAME>(pools)));
+    /// positions are needed by phrase queries only, without them the database is smaller and built sooner. The
+    /// prefixed terms, paths and contents hashes, never carry positions: "prefixes" indexes them as "off" does
+    const std::string&& retval = settings.value("positions", "on").toString().toStdString();
+    settings.endGroup();
+    return retval != "off" && retval != "prefixes";
+}
+
+const XDGSearch::compactionType XDGSearch::ConfigurationBase::enqueryCompaction()
+{
+    XDGSearch::compactionType retval("standard", false, 50);
+    if(std::get<XDGPOOLNAME>(pools).empty())
+        return retval;
+
+    settings.beginGroup(QString::fromStdString(std::get<XDGPOOLNAME>(pools)));
+    std::get<COMPACTIONLEVEL>(retval) = settings.value("compaction", "standard").toString().toStdString();
+    std::get<SINGLEFILE>(retval)      = settings.value("singlefile", false).toBool();   /// quicker to open and to copy, but each update unpacks it
+    std::get<REGROWTH>(retval)        = settings.value("regrowth", 50).toUInt();        /// percent, updates are compacted once they grew this much
+    settings.endGroup();
+    return retval;
+}
+
 void XDGSearch::ConfigurationBase::removeHelper(const std::string& h)
 {
     settings.beginGroup("helpers");
@@ -366,6 +412,73 @@ bool XDGSearch::ConfigurationBase::askForConfirmation()
     return retval;
 }
 
+bool XDGSearch::ConfigurationBase::watchPools()
+{
+    settings.beginGroup("global");
+    const bool&& retval = settings.value("watchPools", false).toBool();    /// the pool directories are watched only on demand
+    settings.endGroup();
+    return retval;
+}
+
+unsigned int XDGSearch::ConfigurationBase::rescanInterval()
+{
+    settings.beginGroup("global");
+    const unsigned int&& retval = settings.value("rescanInterval", 30).toUInt();   /// used when the directories can't be watched
+    settings.endGroup();
+    return retval ? retval : 30;
+}
+
+unsigned long long XDGSearch::ConfigurationBase::textCacheSize()
+{
+    settings.beginGroup("global");
+    const unsigned long long&& retval = settings.value("textCacheSize", 256).toULongLong();    /// megabytes, 0 disables the cache
+    settings.endGroup();
+    return retval * 1024 * 1024;
+}
+
+unsigned long long XDGSearch::ConfigurationBase::extractionBudget()
+{
+    settings.beginGroup("global");
+    const unsigned long long&& retval = settings.value("extractionBudget", 256).toULongLong();   /// megabytes of helpers' output held at once, 0 means no limit
+    settings.endGroup();
+    return retval * 1024 * 1024;
+}
+
+unsigned int XDGSearch::ConfigurationBase::concurrentHelpers()
+{
+    settings.beginGroup("global");
+    const unsigned int&& retval = settings.value("concurrentHelpers", 0).toUInt();   /// by default the amount follows the machine load
+    settings.endGroup();
+    return retval;
+}
+
+const std::string XDGSearch::ConfigurationBase::stagingDirectory()
+{
+    settings.beginGroup("global");
+    const std::string&& retval = settings.value("stagingDirectory", "").toString().toStdString();   /// e.g. /tmp when it isn't a tmpfs
+    settings.endGroup();
+    return retval;
+}
+
+bool XDGSearch::ConfigurationBase::directBuild()
+{
+    settings.beginGroup("global");
+    const bool&& retval = settings.value("directBuild", false).toBool();   /// by default a full build is staged then compacted
+    settings.endGroup();
+    return retval;
+}
+
+const XDGSearch::priorityType XDGSearch::ConfigurationBase::enqueryPriority()
+{
+    XDGSearch::priorityType retval;
+    settings.beginGroup("global");  /// by default builds nobody waits for keep out of the desktop's way
+    std::get<CPUPOLICY>(retval) = settings.value("cpuPolicy", "batch").toString().toStdString();
+    std::get<NICELEVEL>(retval) = settings.value("niceLevel", 10).toInt();
+    std::get<IOCLASS>(retval)   = settings.value("ioClass"  , "idle").toString().toStdString();
+    settings.endGroup();
+    return retval;
+}
+
 void XDGSearch::ConfigurationBase::saveMainWindowGeometry(const QByteArray& g)
 {
     settings.beginGroup("global");
@@ -394,9 +507,33 @@ bool XDGSearch::ConfigurationBase::isPopulatedDB(const Pool& p)
     settings.beginGroup(QString::fromStdString(k));
     const auto&& dbName = settings.value("localpoolname").toString();     /// looks for the local pool name in .conf file
     settings.endGroup();
-    const QDir d(dbName);     /// try to open the directory of the database
+    const QFileInfo d(dbName);    /// the directory of the database, or its file when it's a single file one
 
-    return d.exists();  /// return true if the directory exist
+    return d.exists();  /// return true if the database exist
+}
+
+const std::vector<std::pair<std::string, std::string>> XDGSearch::ConfigurationBase::overlappingPools()
+{
+    std::vector<std::pair<std::string, QString>> dirs;     /// XDG key and canonical directory of each configured pool
+    for(auto p = Pool::DESKTOP; p != Pool::END; ++p)    {
+        const std::string&& k = toXDGKey(p);
+        settings.beginGroup(QString::fromStdString(k));
+        const auto&& dirPath = settings.value("pooldirpath").toString();
+        const bool&& configured = !settings.value("localpoolname").toString().isEmpty();
+        settings.endGroup();
+        const auto&& canonical = QDir(dirPath).canonicalPath();    /// symbolic links resolved, empty when missing
+        if(configured && !dirPath.isEmpty() && !canonical.isEmpty())
+            dirs.emplace_back(k, canonical);
+    }
+
+    std::vector<std::pair<std::string, std::string>> retval;
+    for(const auto& inner : dirs)
+        for(const auto& outer : dirs)
+            if(  &inner != &outer
+              && (  inner.second == outer.second    /// e.g.: two XDG keys bound to the home directory
+                 || inner.second.startsWith(outer.second == "/" ? outer.second : outer.second + "/") ))
+                retval.emplace_back(inner.first, outer.first);
+    return retval;
 }
 
 const std::string XDGSearch::toXDGKey(const XDGSearch::Pool& p)
@@ -22,6 +22,7 @@
 #include <memory>
 #include <utility>
 #include <tuple>
+#include <vector>
 #include <QSettings>
 
 namespace XDGSearch {                   /// open the application namespace
@@ -63,6 +64,35 @@ enum {
     , GRANULARITY   /// number of lines length of a document, 0 means documents length of 15 lines
 };
 
+using walkerType = std::tuple<std::string           ///  0 exclude patterns
+                            , unsigned int          ///  1 maximum depth
+                            , unsigned long long    ///  2 maximum file size
+                            , bool>;                ///  3 skip hidden
+enum {
+      EXCLUDEPATTERNS   /// comma separated list of gitignore style patterns excluded from the pool walk
+    , MAXDEPTH          /// number of sub-directory levels below the pool directory to descend, 0 means no limit
+    , MAXFILESIZE       /// files bigger than this amount of bytes are not indexed, 0 means no limit
+    , SKIPHIDDEN        /// when true hidden directories are not walked, hidden files are
+};
+
+using priorityType = std::tuple<std::string       ///  0 cpu policy
+                              , int               ///  1 nice level
+                              , std::string>;     ///  2 io class
+enum {
+      CPUPOLICY     /// scheduling policy of the indexing threads and helpers: normal, batch or idle
+    , NICELEVEL     /// nice value of the indexing threads and helpers, from -20 to 19
+    , IOCLASS       /// I/O scheduling class of the indexing threads and helpers: normal, besteffort or idle
+};
+
+using compactionType = std::tuple<std::string     ///  0 compaction level
+                                , bool            ///  1 single file
+                                , unsigned int>;  ///  2 regrowth
+enum {
+      COMPACTIONLEVEL   /// how tightly the tables are packed: standard, full or fuller
+    , SINGLEFILE        /// when true the database is a single read-only file instead of a directory
+    , REGROWTH          /// an updated database grown by this percentage since its compaction is compacted again, 0 means never
+};
+
 const std::string toXDGKey(const Pool&);              /// translate from Pool type item to string name key
 class Configuration;                    /// Interface class for configuration/settings  operation
 class ConfigurationBase;                /// "Cheshire Cat" implemention class for Configuration class
@@ -87,13 +117,25 @@ public:
 private:
     bool isFirstRun();                                      /// check if "askQuitConfirmation" entry exist in the .conf file
     bool isPopulatedDB(const Pool&);                        /// check if the object build from the specified pool has an already existing database
+    const std::vector<std::pair<std::string, std::string>> overlappingPools();    /// XDG keys of the pools nested in another pool's directory, and of that pool
     void writeSettings(const helperType&);                  /// write to .conf file contents of the tuple object
     void writeSettings(const poolType&);                    /// write to .conf file contents of the tuple object
     const helperType enqueryHelper(const std::string&);     /// return a tuple reading data from the .conf file
     const poolType   enqueryPool();                         /// return a tuple reading data from the .conf file
+    const walkerType enqueryWalker();                       /// return the pool walking rules reading data from the .conf file
+    bool indexPositions();                                  /// query pool section "positions" entry: on, off or prefixes
+    const compactionType enqueryCompaction();               /// query pool section "compaction", "singlefile" and "regrowth" entries
     void removeHelper(const std::string&);                  /// remove all entries for the specified helper name in .conf file
     bool askForConfirmation();                              /// query .conf file "askQuitConfirmation" entry
     void setAskForConfirmation(bool);                       /// set "askQuitConfirmation" .conf file entry
+    bool watchPools();                                      /// query .conf file "watchPools" entry, keep the databases up to date
+    unsigned int rescanInterval();                          /// query .conf file "rescanInterval" entry, minutes
+    unsigned long long textCacheSize();                     /// query .conf file "textCacheSize" entry, bytes
+    unsigned long long extractionBudget();                  /// query .conf file "extractionBudget" entry, bytes
+    unsigned int concurrentHelpers();                       /// query .conf file "concurrentHelpers" entry, 0 means adaptive
+    const std::string stagingDirectory();                   /// query .conf file "stagingDirectory" entry, empty means beside the databases
+    bool directBuild();                                     /// query .conf file "directBuild" entry, no staging copy nor compaction
+    const priorityType enqueryPriority();                   /// query .conf file "cpuPolicy", "niceLevel" and "ioClass" entries of background builds
     QStringList getHelpersNameList();                       /// query .conf file for the helpers list
     void saveMainWindowGeometry(const QByteArray&);         /// set geometry and window position in .conf file
     const QByteArray readMainWindowGeometry();              /// query geometry and window position in .conf file
@@ -105,6 +147,7 @@ protected:
     const std::string getPoolOnStartup();
     void setPoolOnStartup(const std::string&);
     poolType pools;
+    walkerType walker;                                      /// default walking rules, overridden by the .conf file ones
     QSettings settings;
 };
 
@@ -121,11 +164,23 @@ public:
     void addHelperToPool(const std::string& h) const    { d ->addHelperToPool(h); }
     const helperType enqueryHelper(const std::string& h) const      { return d ->enqueryHelper(h); }
     const poolType   enqueryPool() const        { return d ->enqueryPool(); }
+    const walkerType enqueryWalker() const      { return d ->enqueryWalker(); }
+    bool indexPositions() const     { return d ->indexPositions(); }
+    const compactionType enqueryCompaction() const  { return d ->enqueryCompaction(); }
     void removeHelper(const std::string& h) const   { d ->removeHelper(h); }
     bool askForConfirmation() const     { return d ->askForConfirmation(); }
     void setAskForConfirmation(bool b) const    { d ->setAskForConfirmation(b); }
+    bool watchPools() const     { return d ->watchPools(); }
+    unsigned int rescanInterval() const     { return d ->rescanInterval(); }
+    unsigned long long textCacheSize() const    { return d ->textCacheSize(); }
+    unsigned long long extractionBudget() const { return d ->extractionBudget(); }
+    unsigned int concurrentHelpers() const      { return d ->concurrentHelpers(); }
+    const std::string stagingDirectory() const  { return d ->stagingDirectory(); }
+    bool directBuild() const    { return d ->directBuild(); }
+    const priorityType enqueryPriority() const  { return d ->enqueryPriority(); }
     bool isFirstRun() const     { return d ->isFirstRun(); }
     bool isPopulatedDB(const Pool& p) const     { return d ->isPopulatedDB(p); }
+    const std::vector<std::pair<std::string, std::string>> overlappingPools() const    { return d ->overlappingPools(); }
     void initSettings() const   { return d ->initSettings(); }
     void writeSettings(const helperType& ht) const  { return d ->writeSettings(ht); }
     void writeSettings(const poolType& pt) const    { return d ->writeSettings(pt); }
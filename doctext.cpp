@@ -0,0 +1,222 @@
+/* XDGSearch is a XAPIAN based file indexer and search tool.
+
+    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "doctext.h"
+#include "hash.h"
+#include <zstd.h>
+#include <zdict.h>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+const char* const formatKey = "paragraphFormat";            /// metadata of the database, the version of an encoded pool
+const char* const dictionaryKey = "paragraphDictionary";
+
+struct dictionaryEntry {
+    std::string content;
+    ZSTD_DDict* decompression;      /// digested when the dictionary is registered, shared by the threads
+    ZSTD_CDict* compression;        /// digested the first time a build encodes with it
+};
+std::mutex dictionariesMutex;
+std::map<uint64_t, dictionaryEntry> dictionaries;   /// by id, never erased: the digested dictionaries stay valid
+
+uint64_t dictionaryIdOf(const std::string& d)
+{
+    return XDGSearch::hashString(d);
+}
+
+bool registerDictionary(const std::string& d)   /// false if another dictionary holds its id
+{
+    std::lock_guard<std::mutex> lk(dictionariesMutex);
+    const auto&& r = dictionaries.emplace(dictionaryIdOf(d), dictionaryEntry { d, nullptr, nullptr });
+    if(!r.second)
+        return r.first ->second.content == d;
+    r.first ->second.decompression = ZSTD_createDDict(d.data(), d.size());
+    if(!r.first ->second.decompression)
+        throw std::bad_alloc();
+    return true;
+}
+
+const ZSTD_DDict* findDictionary(uint64_t id)
+{
+    std::lock_guard<std::mutex> lk(dictionariesMutex);
+    const auto&& it = dictionaries.find(id);
+    return it == dictionaries.end() ? nullptr : it ->second.decompression;
+}
+
+const ZSTD_CDict* compressionDictionary(uint64_t id)    /// of a registered dictionary
+{
+    std::lock_guard<std::mutex> lk(dictionariesMutex);
+    auto& e = dictionaries.at(id);
+    if(!e.compression)
+        e.compression = ZSTD_createCDict(e.content.data(), e.content.size(), XDGSearch::TextEncoder::level);
+    if(!e.compression)
+        throw std::bad_alloc();
+    return e.compression;
+}
+
+ZSTD_DCtx* decompressionContext()   /// one for each thread reading paragraphs
+{
+    static thread_local std::unique_ptr<ZSTD_DCtx, std::size_t (*)(ZSTD_DCtx*)> context(ZSTD_createDCtx(), ZSTD_freeDCtx);
+    return context.get();
+}
+
+void putWord(std::string& s, uint64_t w, int bytes)
+{
+    for(int b = 0; b != bytes; ++b)
+        s.push_back(static_cast<char>(w >> (8 * b) & 0xff));
+}
+
+uint64_t getWord(const char* p, int bytes)
+{
+    uint64_t retval = 0;
+    for(int b = bytes - 1; b >= 0; --b)
+        retval = retval << 8 | static_cast<unsigned char>(p[b]);
+    return retval;
+}
+
+const std::size_t headerSize = 14;  /// 0xFF, version, dictionary id, paragraph size
+
+bool decompressText(const char* p, std::size_t n, std::string& text)
+{
+    if(n < headerSize || static_cast<unsigned char>(p[1]) != XDGSearch::TextEncoder::version)
+        return false;       /// written by a later version
+    const ZSTD_DDict* const d = findDictionary(getWord(p + 2, 8));
+    ZSTD_DCtx* const context = decompressionContext();
+    if(!d || !context)
+        return false;
+    text.resize(getWord(p + 10, 4));
+    const std::size_t&& size = ZSTD_decompress_usingDDict(context, &text[0], text.size(), p + headerSize, n - headerSize, d);
+    return !ZSTD_isError(size) && size == text.size();
+}
+}
+
+std::string XDGSearch::documentText(const std::string& data, bool encoded)
+{
+    if(!encoded || data.empty() || static_cast<unsigned char>(data[0]) < 0xFE)    /// verbatim
+        return data;
+    if(static_cast<unsigned char>(data[0]) == 0xFE)
+        return data.substr(1);
+    std::string retval;
+    if(!decompressText(data.data(), data.size(), retval))
+        retval.clear();     /// the dictionary of another database, or a later format
+    return retval;
+}
+
+bool XDGSearch::loadDictionary(const Xapian::Database& db)
+{
+    if(db.get_metadata(formatKey).empty())
+        return false;
+    const std::string&& d = db.get_metadata(dictionaryKey);
+    if(!d.empty() && !registerDictionary(d))
+        std::cerr << "the paragraph dictionary of a database has the id of another one, its paragraphs can't be read" << std::endl;
+    return true;
+}
+
+XDGSearch::TextEncoder::TextEncoder(Xapian::WritableDatabase& wdb) :
+      db(wdb)
+    , encoded(!wdb.get_metadata(formatKey).empty() || wdb.get_doccount() == 0)    /// an empty database: a build
+    , dictionaryId(0)
+    , dictionary(nullptr)
+    , context(ZSTD_createCCtx())
+    , textBytes(0), dataBytes(0), compressed(0), decodes(0), decodeNanoseconds(0), encodeFailures(0)
+{
+    if(!context)
+        throw std::runtime_error("zstd ZSTD_createCCtx() failed");
+    if(encoded && wdb.get_metadata(formatKey).empty())
+        wdb.set_metadata(formatKey, std::to_string(version));
+    const std::string&& d = encoded ? wdb.get_metadata(dictionaryKey) : std::string();  /// an update keeps the dictionary of the build
+    if(!d.empty() && registerDictionary(d)) {   /// otherwise its id is taken: the paragraphs are stored verbatim
+        dictionaryId = dictionaryIdOf(d);
+        dictionary = compressionDictionary(dictionaryId);
+    }
+}
+
+XDGSearch::TextEncoder::~TextEncoder()
+{
+    ZSTD_freeCCtx(context);
+}
+
+void XDGSearch::TextEncoder::encode(const char* p, std::size_t n, std::string& data)
+{
+    textBytes += n;
+    if(!encoded)    {   /// as the rest of the pool
+        data.assign(p, n);
+        dataBytes += data.size();
+        return;
+    }
+    if(!dictionary && n && sample.size() < sampleSize)  {   /// the first paragraphs are stored verbatim
+        sample.append(p, n);
+        sampleSizes.push_back(n);
+        if(sample.size() >= sampleSize)
+            train();
+    }
+
+    data.clear();
+    if(dictionary && n > 32 && n < 0xffffffffu)    {   /// shorter ones don't shrink
+        data.push_back(static_cast<char>(0xFF));
+        data.push_back(static_cast<char>(version));
+        putWord(data, dictionaryId, 8);
+        putWord(data, n, 4);
+        data.resize(headerSize + ZSTD_compressBound(n));
+        const std::size_t&& size = ZSTD_compress_usingCDict(context, &data[headerSize], data.size() - headerSize, p, n, dictionary);
+        if(!ZSTD_isError(size) && headerSize + size < n)    {
+            data.resize(headerSize + size);
+            bool ok = true;
+            if(++compressed % 64 == 1)  {   /// a sample of them is read back: what a query pays for each paragraph rendered
+                const auto&& t0 = std::chrono::steady_clock::now();
+                std::string text;
+                ok = decompressText(data.data(), data.size(), text) && text.compare(0, std::string::npos, p, n) == 0;
+                decodeNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+                ++decodes;
+            }
+            if(ok)  {
+                dataBytes += data.size();
+                return;
+            }
+            ++encodeFailures;   /// the build goes on, this paragraph is stored verbatim
+        }
+        data.clear();
+    }
+    if(n && static_cast<unsigned char>(p[0]) >= 0xFE)
+        data.push_back(static_cast<char>(0xFE));
+    data.append(p, n);
+    dataBytes += data.size();
+}
+
+void XDGSearch::TextEncoder::train()
+{
+    std::string d(dictionarySize, '\0');
+    const std::size_t&& size = ZDICT_trainFromBuffer(&d[0], d.size(), sample.data(), sampleSizes.data(), sampleSizes.size());
+    sample.clear();
+    sample.shrink_to_fit();
+    sampleSizes.clear();
+    sampleSizes.shrink_to_fit();
+    if(ZDICT_isError(size))
+        return;     /// too few paragraphs or too unlike: the next ones make another sample
+    d.resize(size);
+    if(!registerDictionary(d))
+        return;     /// its id is taken: the paragraphs are stored verbatim
+    dictionaryId = dictionaryIdOf(d);
+    dictionary = compressionDictionary(dictionaryId);
+    db.set_metadata(dictionaryKey, d);
+}
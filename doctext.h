@@ -0,0 +1,73 @@
+/* XDGSearch is a XAPIAN based file indexer and search tool.
+
+    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef XDGSEARCH_INCLUDED_DOCTEXT_H
+#define XDGSEARCH_INCLUDED_DOCTEXT_H
+
+#include <xapian.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+struct ZSTD_CCtx_s;
+struct ZSTD_CDict_s;
+
+namespace XDGSearch {
+class TextEncoder;          /// compresses the paragraphs a build stores as documents' data
+std::string documentText(const std::string&, bool);     /// the paragraph of a document's data, true if the pool is encoded
+bool loadDictionary(const Xapian::Database&);   /// false for a pool built before compression, else documentText() can read it
+}
+
+/// A pool built with compression says so in the metadata of its database, the pools built before hold the paragraph
+/// itself as the data of each document, whatever bytes it begins with. In an encoded pool the data begins with byte
+/// 0xFE: the paragraph follows verbatim, or 0xFF: the format version, 1, the id of the pool's dictionary (8 bytes)
+/// and the size of the paragraph (4 bytes), little endian, then the paragraph as a zstd frame compressed with that
+/// dictionary; any other data is the paragraph itself. Paragraphs are small and alike: the dictionary, trained by
+/// zstd on the first paragraphs of a build, is what makes them shrink. It's kept in the metadata of the database,
+/// updates reuse it, and it's digested once per process for compression and once for decompression, so only the
+/// paragraphs rendered by a query are decompressed. An update of a pool built before compression goes on storing the
+/// paragraphs verbatim, the next full build encodes it.
+class XDGSearch::TextEncoder final {
+public:
+    static const unsigned char version = 1;
+    static const std::size_t sampleSize = 256 * 1024;      /// bytes of paragraphs the dictionary is trained on
+    static const std::size_t dictionarySize = 16 * 1024;
+    static const int level = 3;                             /// zstd's default: level 9 saves 5% more bytes in thrice the time
+    explicit TextEncoder(Xapian::WritableDatabase&);
+    TextEncoder(TextEncoder&&) = delete;
+    TextEncoder& operator=(TextEncoder&&) = delete;
+    ~TextEncoder();
+    void encode(const char*, std::size_t, std::string&);   /// paragraph, its size and the data written
+    unsigned long long getTextBytes() const         { return textBytes; }
+    unsigned long long getDataBytes() const         { return dataBytes; }
+    unsigned long long getDecodeNanoseconds() const { return decodes ? decodeNanoseconds / decodes : 0; }    /// mean of a paragraph
+    unsigned long long getEncodeFailures() const    { return encodeFailures; }  /// paragraphs not read back, stored verbatim
+private:
+    void train();       /// the dictionary out of the sample, stored into the database
+    Xapian::WritableDatabase& db;
+    const bool encoded;     /// false updating a pool built before compression
+    std::string sample;
+    std::vector<std::size_t> sampleSizes;   /// of each paragraph of the sample
+    uint64_t dictionaryId;
+    const ZSTD_CDict_s* dictionary;         /// nullptr until trained
+    ZSTD_CCtx_s* const context;             /// reused by each paragraph
+    unsigned long long textBytes, dataBytes, compressed, decodes, decodeNanoseconds, encodeFailures;
+};
+
+#endif /// XDGSEARCH_INCLUDED_DOCTEXT_H
@@ -0,0 +1,171 @@
+/* XDGSearch is a XAPIAN based file indexer and search tool.
+
+    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "hash.h"
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+const uint64_t prime1 = 11400714785074694791ull;
+const uint64_t prime2 = 14029467366897019727ull;
+const uint64_t prime3 =  1609587929392839161ull;
+const uint64_t prime4 =  9650029242287828579ull;
+const uint64_t prime5 =  2870177450012600261ull;
+
+inline uint64_t rotl(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t read64(const unsigned char* p)     /// little endian, unaligned
+{
+    uint64_t v;
+    std::memcpy(&v, p, sizeof v);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+inline uint32_t read32(const unsigned char* p)
+{
+    uint32_t v;
+    std::memcpy(&v, p, sizeof v);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    return v;
+}
+
+inline uint64_t round(uint64_t acc, uint64_t input)
+{
+    acc += input * prime2;
+    acc = rotl(acc, 31);
+    return acc * prime1;
+}
+
+inline uint64_t mergeRound(uint64_t acc, uint64_t val)
+{
+    acc ^= round(0, val);
+    return acc * prime1 + prime4;
+}
+}
+
+XDGSearch::XXH64::XXH64(uint64_t s) :
+      v { s + prime1 + prime2, s + prime2, s, s - prime1 }
+    , bufferSize(0)
+    , totalSize(0)
+    , seed(s)
+{
+}
+
+void XDGSearch::XXH64::update(const void* data, std::size_t len)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* const end = p + len;
+    totalSize += len;
+
+    if(bufferSize + len < 32)   {   /// not enough for a stripe yet
+        std::memcpy(buffer + bufferSize, p, len);
+        bufferSize += len;
+        return;
+    }
+    if(bufferSize)  {               /// completes the pending stripe first
+        std::memcpy(buffer + bufferSize, p, 32 - bufferSize);
+        p += 32 - bufferSize;
+        for(int i = 0; i != 4; ++i)
+            v[i] = round(v[i], read64(buffer + i * 8));
+        bufferSize = 0;
+    }
+    for(/* null */; p + 32 <= end; p += 32)
+        for(int i = 0; i != 4; ++i)
+            v[i] = round(v[i], read64(p + i * 8));
+    bufferSize = end - p;
+    std::memcpy(buffer, p, bufferSize);
+}
+
+uint64_t XDGSearch::XXH64::digest() const
+{
+    uint64_t h;
+    if(totalSize >= 32) {
+        h = rotl(v[0], 1) + rotl(v[1], 7) + rotl(v[2], 12) + rotl(v[3], 18);
+        for(int i = 0; i != 4; ++i)
+            h = mergeRound(h, v[i]);
+    } else
+        h = seed + prime5;
+    h += totalSize;
+
+    const unsigned char* p = buffer;
+    const unsigned char* const end = buffer + bufferSize;
+    for(/* null */; p + 8 <= end; p += 8)   {
+        h ^= round(0, read64(p));
+        h = rotl(h, 27) * prime1 + prime4;
+    }
+    if(p + 4 <= end)    {
+        h ^= uint64_t(read32(p)) * prime1;
+        h = rotl(h, 23) * prime2 + prime3;
+        p += 4;
+    }
+    for(/* null */; p < end; ++p)   {
+        h ^= (*p) * prime5;
+        h = rotl(h, 11) * prime1;
+    }
+
+    h ^= h >> 33;       /// avalanche
+    h *= prime2;
+    h ^= h >> 29;
+    h *= prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+bool XDGSearch::hashFile(const std::string& fileName, uint64_t& h)
+{
+    const int&& fd = ::open(fileName.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0)
+        return false;
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    XDGSearch::XXH64 state;
+    char buf[1 << 16];
+    ssize_t len;
+    while((len = ::read(fd, buf, sizeof buf)) > 0 || (len < 0 && errno == EINTR))
+        if(len > 0)
+            state.update(buf, len);
+    ::close(fd);
+    if(len < 0)
+        return false;
+    h = state.digest();
+    return true;
+}
+
+uint64_t XDGSearch::hashString(const std::string& s)
+{
+    XDGSearch::XXH64 state;
+    state.update(s.data(), s.size());
+    return state.digest();
+}
+
+std::string XDGSearch::toHex(uint64_t h)
+{
+    char hex[17];
+    std::snprintf(hex, sizeof hex, "%016llx", static_cast<unsigned long long>(h));
+    return hex;
+}
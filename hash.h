@@ -0,0 +1,47 @@
+/* XDGSearch is a XAPIAN based file indexer and search tool.
+
+    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef XDGSEARCH_INCLUDED_HASH_H
+#define XDGSEARCH_INCLUDED_HASH_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace XDGSearch {
+class XXH64;                /// streaming xxHash64, a non cryptographic hash reading several GB/s
+bool hashFile(const std::string&, uint64_t&);   /// xxHash64 of the file contents, false if it can't be read
+uint64_t hashString(const std::string&);        /// xxHash64 of a string
+std::string toHex(uint64_t);                    /// 16 lower case hexadecimal digits
+}
+
+/// Same algorithm and results of the reference XXH64(), see https://github.com/Cyan4973/xxHash
+class XDGSearch::XXH64 final {
+public:
+    explicit XXH64(uint64_t = 0);           /// seed
+    void update(const void*, std::size_t);
+    uint64_t digest() const;
+private:
+    uint64_t v[4];
+    unsigned char buffer[32];               /// tail of the input not yet making a whole stripe
+    std::size_t bufferSize;
+    uint64_t totalSize;
+    const uint64_t seed;
+};
+
+#endif /// XDGSEARCH_INCLUDED_HASH_H
@@ -17,30 +17,144 @@
 */
 
 #include "indexer.h"
+#include "walker.h"
+#include "journal.h"
+#include "textcache.h"
+#include "hash.h"
+#include "concurrency.h"
+#include "priority.h"
+#include "stats.h"
+#include "trace.h"
+#include "chunker.h"
+#include "markup.h"
+#include "stopwords.h"
+#include "stemcache.h"
+#include "doctext.h"
+#include <QDir>
 #include <QDirIterator>
-#include <QStringList>
-#include <QProgressDialog>
+#include <QFileInfo>
+#include <QStandardPaths>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <cstdio>
+#include <cerrno>
 #include <stdexcept>
 #include <new>      /// used for bad_alloc
 #include <future>
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/file.h>
+#include <sys/statvfs.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifndef RENAME_EXCHANGE
+#define RENAME_EXCHANGE (1 << 1)    /// from linux/fs.h, older C libraries don't tell it
+#endif
+
+namespace {
+unsigned long long directorySize(const std::string& dirName)    /// the size of its file for a single file database
+{
+    const QFileInfo fi(QString::fromStdString(dirName));
+    if(fi.isFile())
+        return fi.size();
+    unsigned long long retval = 0;
+    QDirIterator dirIt(QString::fromStdString(dirName), QDir::Files, QDirIterator::Subdirectories);
+    while(dirIt.hasNext())  {
+        dirIt.next();
+        retval += dirIt.fileInfo().size();
+    }
+    return retval;
+}
+
+void removeDB(const std::string& DBName)
+{
+    const QString&& name = QString::fromStdString(DBName);
+    if(QFileInfo(name).isDir())
+        QDir(name).removeRecursively();
+    else
+        QFile::remove(name);
+}
 
+/// the new database takes the place of the previous one: at once when the kernel can, so that a query opens
+/// either the previous database or the new one
+void replaceDB(const std::string& newName, const std::string& DBName)
+{
+    if(::syscall(SYS_renameat2, AT_FDCWD, newName.c_str(), AT_FDCWD, DBName.c_str(), RENAME_EXCHANGE) == 0)
+        removeDB(newName);
+    else    {
+        removeDB(DBName);
+        if(::rename(newName.c_str(), DBName.c_str()) != 0)
+            throw std::runtime_error("can't rename " + newName + " to " + DBName);
+    }
+    std::ofstream(DBName + ".compacted") << directorySize(DBName) << std::endl;     /// read by needsCompaction()
+}
+
+/// free space for bytes1 in dir1 and bytes2 in dir2, they may be on the same file system
+bool hasRoomFor(const std::string& dir1, unsigned long long bytes1, const std::string& dir2, unsigned long long bytes2)
+{
+    struct statvfs fs1, fs2;
+    if(::statvfs(dir1.c_str(), &fs1) != 0 || ::statvfs(dir2.c_str(), &fs2) != 0)
+        return true;        /// unknown, the build tells if it runs out
+    const unsigned long long&& free1 = static_cast<unsigned long long>(fs1.f_bavail) * fs1.f_frsize
+                             , free2 = static_cast<unsigned long long>(fs2.f_bavail) * fs2.f_frsize;
+    if(fs1.f_fsid == fs2.f_fsid)
+        return bytes1 + bytes2 <= free1;
+    return bytes1 <= free1 && bytes2 <= free2;
+}
 
-XDGSearch::IndexerBase::IndexerBase(QWidget* parent, const XDGSearch::Pool& p) :    /// initializes conf member with a Configuration object of Pool p type
-          QWidget(parent)
+/// phrase and near queries turned into and queries, the rest of the query is kept as it is
+Xapian::Query withoutPhrases(const Xapian::Query& q)
+{
+    switch(q.get_type())    {
+    case Xapian::Query::OP_PHRASE:
+    case Xapian::Query::OP_NEAR:
+    case Xapian::Query::OP_AND:
+    case Xapian::Query::OP_OR:
+    case Xapian::Query::OP_AND_NOT:
+    case Xapian::Query::OP_XOR:
+    case Xapian::Query::OP_AND_MAYBE:
+    case Xapian::Query::OP_FILTER:
+    case Xapian::Query::OP_SYNONYM:
+    case Xapian::Query::OP_MAX:
+        break;
+    default:
+        return q;       /// leaves and the operators with parameters the parser makes without phrases
+    }
+    std::vector<Xapian::Query> subqueries;
+    for(std::size_t n = 0; n != q.get_num_subqueries(); ++n)
+        subqueries.push_back(withoutPhrases(q.get_subquery(n)));
+    const bool&& phrase = q.get_type() == Xapian::Query::OP_PHRASE || q.get_type() == Xapian::Query::OP_NEAR;
+    return Xapian::Query(phrase ? Xapian::Query::OP_AND : q.get_type(), subqueries.begin(), subqueries.end());
+}
+}
+
+XDGSearch::IndexerBase::IndexerBase(QObject* parent, const XDGSearch::Pool& p) :    /// initializes conf member with a Configuration object of Pool p type
+          QObject(parent)
         , conf(std::unique_ptr<XDGSearch::Configuration>(new XDGSearch::Configuration(p)))
         , numberOfFiles(0)
+        , sameContentFiles(0)
+        , canceled(false)
+        , interactive(false)
+        , priorityApplied(true)
+        , stats(nullptr)
+        , positions(conf ->indexPositions())
+        , encodedText(false)
 {
     currentPoolSettings = conf ->enqueryPool(); /// retrieves settings of the current pool type
+    currentWalkerSettings = conf ->enqueryWalker();     /// retrieves exclusion rules, depth and size limits of the current pool
 }
 
-XDGSearch::Indexer::Indexer(QWidget* parent, const XDGSearch::Pool& p = XDGSearch::Pool::END) :
+XDGSearch::Indexer::Indexer(QObject* parent, const XDGSearch::Pool& p = XDGSearch::Pool::END) :
     d(new IndexerBase(parent, p))
-{   /// connects two signals: IndexerBase to Indexer
+{   /// connects the signals: IndexerBase to Indexer
     QObject::connect(d, &XDGSearch::IndexerBase::progressValue, this, &Indexer::progressValue);
+    QObject::connect(d, &XDGSearch::IndexerBase::progress, this, &Indexer::progress);
 }
 
 XDGSearch::Indexer::~Indexer()
@@ -48,195 +162,412 @@ XDGSearch::Indexer::~Indexer()
     delete d;
 }
 
-unsigned int XDGSearch::IndexerBase::determineNumberOfFiles()
+std::string XDGSearch::Indexer::documentText(const Xapian::Document& doc) const
 {
-    unsigned int&& retval =0;
-
-    std::istringstream iss(std::get<POOLHELPERS>(currentPoolSettings));   /// stringstream for comma separated helpers list
-    std::forward_list<XDGSearch::helperType> poolHelpers;       /// container for each helper of this pool
-
-    for(std::string h; std::getline(iss, h, ','); /* null */)   /// for each helper in the stringstream object
-        poolHelpers.push_front(conf ->enqueryHelper(h));        /// populate the container that holds items informations
-
-    for(const auto& h : poolHelpers)    {   /// for each helper initializes a thread that's added to the container
-        if(std::get<HELPERNAME>(h).empty())          /// dummy checks, eventually skips empty helper
-            continue;
-        std::istringstream iss(std::get<EXTENSIONS>(h));
-        QStringList filesExtensionFilter;   /// define a QT string list container that'll act as file extension filter
-
-        for(std::string e; std::getline(iss, e, ','); ) {
-            e = "*." + e;       /// prepare the string to add to the container, e.g.: *.pdf
-            filesExtensionFilter  << QString::fromStdString(e); /// populate the QStringList container
-        }
-        /// define a file iterator that:
-        QDirIterator dirIt( QString::fromStdString(std::get<POOLDIRPATH>(currentPoolSettings))    /// reads from the pool directory and so on
-                          , filesExtensionFilter        /// evaluate only these file extensions
-                          , QDir::Files                 /// consider only files
-                          , QDirIterator::Subdirectories | QDirIterator::FollowSymlinks );  /// recurse sub-directory and evaluate sym-links
-
-        while(dirIt.hasNext())  {   /// outer loop: until file iterator reaches the end
-            dirIt.next();
-            ++retval;
-        }
-    }
-    return retval;
+    return XDGSearch::documentText(doc.get_data(), d ->encodedText);
 }
 
-bool XDGSearch::IndexerBase::populateDB()
+bool XDGSearch::IndexerBase::populateDB(bool incremental)
 {
-    QTemporaryDir tempDir;      /// provide an auto-remove temporary directory under /tmp
-    while(!tempDir.isValid())   /// iterate until has a valid temporary directory name
-        ;
+    const bool&& direct = conf ->directBuild();
+    QTemporaryDir tempDir(direct ? QString::fromStdString(std::get<LOCALPOOLNAME>(currentPoolSettings) + ".staging-XXXXXX")
+                                 : stagingTemplate(std::get<LOCALPOOLNAME>(currentPoolSettings)));  /// auto-remove staging directory
+    if(!tempDir.isValid())  {
+        std::cerr << "can't create the staging directory " << tempDir.path().toStdString() << std::endl;
+        return false;
+    }
 
     const std::string  tmpDirName  =  tempDir.path().toStdString() + "/"
                      , DBName  =  std::get<LOCALPOOLNAME>(currentPoolSettings)
                      , tmpDBName  =  tmpDirName + DBName;       /// provides names for database and temporary database
 try {
-    /// try to create the temporary database under /tmp
-    Xapian::WritableDatabase tmpDB( tmpDBName
-                                  , Xapian::DB_CREATE
-                                  , Xapian::DB_BACKEND_GLASS);
+    std::vector<XDGSearch::helperType> poolHelpers;     /// container for each helper of this pool
+    std::vector<std::string> helpersExtensions;         /// comma separated extensions list of each helper
+    enqueryPoolHelpers(poolHelpers, helpersExtensions);
+    /// held until the new database and its journal are in place: a watcher update waits for them, then it retries
+    const XDGSearch::UpdateLock updateLock(DBName, true);
+
+    /// journals of the previous and of this scan, see journal.h
+    const std::string journalName = DBName + ".journal";
+    XDGSearch::Journal previousJournal( std::get<POOLDIRPATH>(currentPoolSettings), walkingRulesSignature(helpersExtensions))
+                     , currentJournal( std::get<POOLDIRPATH>(currentPoolSettings), walkingRulesSignature(helpersExtensions));
+    /// an update needs an existing database and a journal written with the same walking rules, otherwise it's a full rebuild
+    const bool&& journaled = previousJournal.load(journalName);
+    incremental = incremental
+               && QFileInfo(QString::fromStdString(DBName)).exists()
+               && journaled;
+    if(journaled)   /// a rebuild too doesn't read again the unchanged files to hash them
+        currentJournal.inheritHashes(previousJournal);
+
+    const bool&& singleFile = QFileInfo(QString::fromStdString(DBName)).isFile();
+    if(!incremental || singleFile)  {   /// the previous database tells how big this one will be
+        const unsigned long long&& previousSize = directorySize(DBName);
+        if(!hasRoomFor(tmpDirName, 2 * previousSize, ".", direct ? 0 : previousSize))  {   /// uncompacted, then compacted
+            std::cerr << DBName << ": not enough free space to build the database, about "
+                      << 3 * previousSize / (1024 * 1024) << " MiB are needed in " << tmpDirName << " and beside the database" << std::endl;
+            return false;
+        }
+    }
+    if(incremental && singleFile)   /// it's read-only, the update is done on a writable copy in the staging directory
+        Xapian::Database(DBName).compact(tmpDBName);
+    /// try to open the pool's database for an update, else try to create the database in the staging directory
+    Xapian::WritableDatabase writableDB = incremental
+                                        ? Xapian::WritableDatabase(singleFile ? tmpDBName : DBName, Xapian::DB_OPEN)
+                                        : Xapian::WritableDatabase( tmpDBName
+                                                                  , Xapian::DB_CREATE
+                                                                  , Xapian::DB_BACKEND_GLASS);
+
+    XDGSearch::BuildStats buildStats;
+    stats = &buildStats;
+    /// set before the walker starts its threads, they inherit it
+    priorityApplied = XDGSearch::applyPriority(interactive ? XDGSearch::interactivePriority() : conf ->enqueryPriority());
 
     numberOfFiles =0;       /// stores the number of files processed during database building: 0 initial value
-    const auto&& nof = determineNumberOfFiles();     /// amount of files to process, nof: grand total of Number Of Files
-    QProgressDialog progressDialog(this);       /// create a progress dialog window
-    /// progress dialog window setting stuff:
-    progressDialog.setWindowModality(Qt::WindowModal);
-    progressDialog.setCancelButtonText(QObject::trUtf8("&Cancel"));
-    progressDialog.setRange(0, nof);
-    progressDialog.setWindowTitle(QObject::trUtf8("Indexing %1 files").arg(QString::fromStdString(DBName)));
-    progressDialog.setMinimumDuration(0);
-    /// setting ends
-    bool progressCanceled(false);   /// it becomes true when the Cancel button of the progress dialog window is clicked
-    const unsigned int&& threadsNumber = 30;     /// tweaked value of the amount of times the std::async function is called,
-                                                /// it gives best results on eight core CPU
-    std::forward_list<std::future<std::pair<std::string, std::string>>> futureContainer;    /// container for 30 std::future objects
-    std::istringstream issHlp(std::get<POOLHELPERS>(currentPoolSettings));   /// stringstream for comma separated helpers list
+    sameContentFiles = 0;
+    canceled = false;
+    bool progressCanceled(false);   /// it becomes true once cancel() is called, e.g. by the Cancel button of a progress dialog window
+    XDGSearch::Concurrency helpers(DBName, conf ->concurrentHelpers());   /// the amount of extractions running at once
+    XDGSearch::ByteBudget& budget = XDGSearch::ByteBudget::shared();
+    budget.setLimit(conf ->extractionBudget());
+    XDGSearch::TextCache textCache("./textcache", conf ->textCacheSize());     /// helpers' output of the files that didn't change
+    XDGSearch::ContentClaims claims;        /// a helper runs once for all the files with the same contents
+    std::vector<XDGSearch::extractionType> sameContent;     /// files whose twin wasn't stored yet when they came
+    std::atomic<unsigned long long> oldestTicket(0);         /// ticket of the extraction at the front of futureContainer
+    unsigned long long nextTicket = 0;
+    std::deque<std::tuple<std::future<XDGSearch::extractionType>, unsigned int, std::unique_ptr<XDGSearch::BudgetSlot>>>
+            futureContainer;    /// extractions in flight, oldest first: the future, the granularity of their helper and their share of the budget
+    Xapian::TermGenerator indexer;
+    const auto&& stopper = loadStopWords();     /// shared with the other builds and the queries
+    prepareTermGenerator(indexer, stopper.get());
+    XDGSearch::FileContext fileContext(writableDB);     /// reused by all the files stored
+
+    /// define a file walker that crawls the pool directory once for all the helpers, it yields files as soon as they
+    /// are found so extraction starts at once, directories excluded by the pool's walking rules are pruned
+    /// on update only new or changed files are yielded, the directories unchanged since the previous scan aren't read
+    XDGSearch::Walker dirIt( std::get<POOLDIRPATH>(currentPoolSettings)
+                           , helpersExtensions
+                           , currentWalkerSettings
+                           , 0
+                           , incremental ? &previousJournal : nullptr
+                           , &currentJournal );
+
+    /// a sliding window of extractions: the walker is pulled only while both the amount of extractions and the
+    /// bytes of output held in memory allow it, the results are stored in the order the files were found
+    while(true) {
+        while( futureContainer.size() < helpers.limit()
+            && (futureContainer.empty() || !budget.isExhausted()) )    {
+            std::string fileFullPathName;   /// fully qualified file name
+            {
+                const XDGSearch::BuildStats::Timer t(stats, XDGSearch::BuildStats::WALK);  /// the walker may still be crawling
+                if(!dirIt.hasNext())
+                    break;
+                fileFullPathName = dirIt.next();
+            }
+            const auto& helper = poolHelpers[dirIt.getHelper()];   /// the helper whose extensions the file matched
+            std::unique_ptr<XDGSearch::BudgetSlot> slot(new XDGSearch::BudgetSlot(budget, oldestTicket, nextTicket++));
+            auto&& ftr = std::async( XDGSearch::forEachFile     /// std::async calls forEachFile() function to create
+                                   , fileFullPathName           /// a std::future object stored in futureContainer
+                                   , helper
+                                   , &textCache
+                                   , &claims
+                                   , &currentJournal
+                                   , slot.get()
+                                   , stats );
+            futureContainer.emplace_back(std::move(ftr), std::get<GRANULARITY>(helper), std::move(slot));
+        }
+        if(futureContainer.empty())     /// no more files to process
+            break;
+
+        auto& front = futureContainer.front();
+        auto&& extraction = std::get<0>(front).get();     /// it fetch results
+        const auto&& nof = dirIt.getFoundFiles();   /// amount of files found so far, nof: Number Of Files, it grows while the walker crawls
+        emit progress(++numberOfFiles, nof, dirIt.isCrawling());    /// it increments numberOfFiles then pass the value to the listeners
+
+        if (canceled)   {                       /// if the user asked to stop then
+            progressCanceled = true;            /// set progressCanceled to true then
+            break;                              /// it exits the loop
+        }
+        const double&& progressBarValue = double(numberOfFiles) / nof * 100.;    /// it calculates the progress value in percent
+        emit progressValue(progressBarValue);   /// it emits signal caught by mainwindow progressBar object
+
+        {
+            const XDGSearch::Trace::Span span("store", std::get<FILENAME>(extraction));
+            if(incremental)     /// the documents of a changed file are replaced
+                removeFile(writableDB, std::get<FILENAME>(extraction));
+
+            if(attachFile(writableDB, extraction))  /// same contents of a file already stored: its documents get this path too
+                ++sameContentFiles;
+            else if(std::get<SAMECONTENT>(extraction))
+                sameContent.push_back(extraction);
+            else
+                indexDocuments(writableDB, indexer, extraction, std::get<1>(front), fileContext);
+        }
+        if(direct && numberOfFiles % 1000 == 0) {   /// written where it stays: batches bound what Xapian holds in memory
+            const XDGSearch::BuildStats::Timer t(stats, XDGSearch::BuildStats::COMMIT);
+            writableDB.commit();
+        }
+        XDGSearch::BufferPool::shared().give(std::move(std::get<HELPEROUTPUT>(extraction)));  /// the next extractions read into it
+
+        ++oldestTicket;
+        futureContainer.pop_front();    /// it gives back the budget share of the stored output
+        helpers.completed();
+    }
+    while(!futureContainer.empty()) {   /// on cancel: the extractions in flight finish in order, each one in turn is the oldest
+        std::get<0>(futureContainer.front()).wait();
+        ++oldestTicket;
+        futureContainer.pop_front();
+    }
+    if(progressCanceled)    {
+        writableDB.close();
+        stats = nullptr;
+        return false;
+    }
+    for(const auto& e : sameContent)    /// their twins are stored by now, unless the helper printed nothing
+        if(attachFile(writableDB, e))
+            ++sameContentFiles;
+    if(sameContentFiles)
+        std::clog << DBName << ": " << sameContentFiles << " files share the documents of a file with the same contents" << std::endl;
+    for(const auto& dup : dirIt.getDuplicates())    /// reports the directories and files the walker skipped because already visited
+        std::clog << DBName << ": skipped duplicate \"" << dup.first << "\" same as \"" << dup.second << "\"" << std::endl;
+    if(textCache.isEnabled())
+        std::clog << DBName << ": text cache " << textCache.getHits() << " hits, " << textCache.getMisses() << " misses" << std::endl;
+    std::clog << DBName << ": peak helpers' output in memory " << budget.getPeak() / 1024 << " KiB, budget "
+              << conf ->extractionBudget() / 1024 << " KiB, peak resident memory " << XDGSearch::peakRSS() / 1024 << " KiB" << std::endl;
+
+    if(incremental)
+        for(const auto& f : previousJournal.removedSince(currentJournal))   /// deletes the documents of the files gone since the previous scan
+            removeFile(writableDB, f);
+    {
+        const XDGSearch::BuildStats::Timer t(stats, XDGSearch::BuildStats::COMMIT);
+        writableDB.commit();
+    }
+    /// a full build is compacted from the staging directory to $HOME/.local/share/XDGSearch/xdgsearch, an update only when
+    /// it has to, a direct build is just swapped in
+    const bool&& compacted = incremental ? singleFile || needsCompaction(DBName) : !direct;
+    if(compacted)   {
+        const XDGSearch::BuildStats::Timer t(stats, XDGSearch::BuildStats::COMPACT);
+        compactDB(writableDB, DBName);
+    }
+    writableDB.close();
+    if(direct && !incremental)
+        replaceDB(tmpDBName, DBName);
+    currentJournal.save(journalName);   /// only once the database holds what the journal tells
+
+    buildStats.setCounter("incremental", incremental);
+    buildStats.setCounter("files", numberOfFiles);
+    buildStats.setCounter("sameContentFiles", sameContentFiles);
+    buildStats.setCounter("textCacheHits", textCache.getHits());
+    buildStats.setCounter("textCacheMisses", textCache.getMisses());
+    buildStats.setCounter("peakOutputBytes", budget.getPeak());
+    buildStats.setCounter("peakRSS", XDGSearch::peakRSS());
+    buildStats.setCounter("compacted", compacted);
+    buildStats.setCounter("direct", direct && !incremental);
+    buildStats.setCounter("positions", positions);
+    buildStats.setCounter("paragraphTextBytes", fileContext.getEncoder().getTextBytes());
+    buildStats.setCounter("paragraphDataBytes", fileContext.getEncoder().getDataBytes());  /// stored, compressed or not
+    buildStats.setCounter("paragraphDecodeNanoseconds", fileContext.getEncoder().getDecodeNanoseconds());
+    buildStats.setCounter("paragraphEncodeFailures", fileContext.getEncoder().getEncodeFailures());
+    buildStats.setCounter("databaseBytes", directorySize(DBName));  /// with the build time, the cost of the positions
+    buildStats.save(DBName + ".stats.json");    /// read by the Statistics page of the Preferences window
+    stats = nullptr;
 
+    return true;
+}
+    catch(const Xapian::Error& e)  {
+        std::cerr << e.get_description() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    catch(const std::runtime_error& e)  {
+        std::cerr << e.what() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    catch(const std::bad_alloc& e)  {
+        std::cerr << e.what() << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+void XDGSearch::IndexerBase::enqueryPoolHelpers( std::vector<XDGSearch::helperType>& poolHelpers
+                                               , std::vector<std::string>& helpersExtensions ) const
+{
+    std::istringstream issHlp(std::get<POOLHELPERS>(currentPoolSettings));   /// stringstream for comma separated helpers list
     for(std::string h; std::getline(issHlp, h, ','); /* null */)   {   /// for each helper in the stringstream object
         const auto& helper = conf ->enqueryHelper(h);       /// fetch the helper tuple object
         if(std::get<HELPERNAME>(helper).empty())            /// dummy checks, eventually skips empty helper
             continue;
-        const std::string& stopWordsFile = "./stopwords/" + std::get<STOPWORDSFILE>(currentPoolSettings);   /// it gets the pathname of stopword file
-
-        Xapian::Stem stemmer(std::get<STEMMING>(currentPoolSettings));      /// it selects the stemming language set in the pool's configuration
-        Xapian::TermGenerator indexer;
-        Xapian::SimpleStopper sstopper;
-        std::fstream ifs(stopWordsFile);        /// it opens the stopwordfile
-
-        indexer.set_stemmer(stemmer);
-        if(ifs) {       /// it checks if the user set the stopwords file, then populate the simplestopper object
-            for(std::string s; std::getline(ifs, s); /* null */)
-                sstopper.add(s);
-            indexer.set_stopper(&sstopper);
-        }
+        poolHelpers.push_back(helper);
+        helpersExtensions.push_back(std::get<EXTENSIONS>(helper));
+    }
+}
+
+std::shared_ptr<const XDGSearch::StopWords> XDGSearch::IndexerBase::loadStopWords() const
+{
+    if(std::get<STOPWORDSFILE>(currentPoolSettings).empty() || std::get<STOPWORDSFILE>(currentPoolSettings) == "none")
+        return nullptr;
+    /// the same directory isFirstRun() makes the working directory, whatever the working directory is now
+    return XDGSearch::StopWords::load( QStandardPaths::writableLocation(QStandardPaths::DataLocation).toStdString()
+                                     + "/stopwords/" + std::get<STOPWORDSFILE>(currentPoolSettings) );
+}
 
-        std::istringstream issExt(std::get<EXTENSIONS>(helper));    /// stringstream object for comma separated extensions list
-        QStringList filesExtensionFilter;   /// define a QT string list container that'll act as file extension filter
+void XDGSearch::IndexerBase::prepareTermGenerator(Xapian::TermGenerator& indexer, const XDGSearch::StopWords* stopper) const
+{
+    /// it selects the stemming language set in the pool's configuration
+    indexer.set_stemmer(XDGSearch::cachedStem(std::get<STEMMING>(currentPoolSettings)));
+    if(stopper)     /// it checks if the user set the stopwords file
+        indexer.set_stopper(stopper);
+}
+
+void XDGSearch::IndexerBase::compactDB(Xapian::Database& db, const std::string& DBName) const
+{
+    const XDGSearch::compactionType&& c = conf ->enqueryCompaction();
+    unsigned int flags = std::get<COMPACTIONLEVEL>(c) == "fuller" ? Xapian::Compactor::FULLER
+                       : std::get<COMPACTIONLEVEL>(c) == "full"   ? Xapian::Compactor::FULL
+                       :                                            Xapian::Compactor::STANDARD;
+    if(std::get<SINGLEFILE>(c))
+        flags |= Xapian::DBCOMPACT_SINGLEFILE;
+
+    const std::string&& newName = DBName + ".compacting";
+    removeDB(newName);      /// left by a build that didn't end
+    db.compact(newName, flags);
+    db.close();
+    replaceDB(newName, DBName);
+}
+
+QString XDGSearch::IndexerBase::stagingTemplate(const std::string& DBName) const
+{
+    /// beside the databases by default: the same file system, and no tmpfs filled with the whole uncompacted index
+    const std::string&& dir = conf ->stagingDirectory();
+    return QString::fromStdString((dir.empty() ? "." : dir) + "/" + DBName + ".staging-XXXXXX");
+}
+
+unsigned long long XDGSearch::IndexerBase::walkingRulesSignature(const std::vector<std::string>& helpersExtensions) const
+{
+    std::string walkingRules = std::get<EXCLUDEPATTERNS>(currentWalkerSettings)     /// whatever decides which files are walked
+                             + ';' + std::to_string(std::get<MAXDEPTH>(currentWalkerSettings))
+                             + ';' + std::to_string(std::get<MAXFILESIZE>(currentWalkerSettings))
+                             + ';' + (std::get<SKIPHIDDEN>(currentWalkerSettings) ? "hiddendirs" : "0");  /// the journals of hidden files skipped too don't match
+    for(const auto& ext : helpersExtensions)
+        walkingRules += ';' + ext;
+    return XDGSearch::Journal::signature(walkingRules);
+}
+
+bool XDGSearch::IndexerBase::needsCompaction(const std::string& DBName) const
+{
+    const unsigned int&& regrowth = std::get<REGROWTH>(conf ->enqueryCompaction());
+    unsigned long long compactedSize = 0;
+    if(!regrowth || !(std::ifstream(DBName + ".compacted") >> compactedSize))   /// compacted before its size was kept
+        return false;
+    return directorySize(DBName) > compactedSize + compactedSize / 100 * regrowth;
+}
 
-        for(std::string e; std::getline(issExt, e, ','); ) {
-            e = "*." + e;       /// prepare the string to add to the container, e.g.: *.pdf
-            filesExtensionFilter  << QString::fromStdString(e); /// populates the QStringList container with the prepared extensions
+bool XDGSearch::IndexerBase::updateFiles(const std::vector<std::string>& changed)
+{
+    const std::string DBName = std::get<LOCALPOOLNAME>(currentPoolSettings);
+try {
+    const XDGSearch::UpdateLock updateLock(DBName);     /// throws DatabaseLockError while a build or a compaction holds it
+    const bool&& singleFile = QFileInfo(QString::fromStdString(DBName)).isFile();
+    std::unique_ptr<QTemporaryDir> tempDir;
+    std::string tmpDBName;
+    if(singleFile)  {   /// read-only: the copy in the staging directory is updated, then packed again
+        tempDir = std::unique_ptr<QTemporaryDir>(new QTemporaryDir(stagingTemplate(DBName)));
+        if(!tempDir ->isValid())    {
+            std::cerr << "can't create the staging directory " << tempDir ->path().toStdString() << std::endl;
+            return false;
         }
-        /// define a file iterator that:
-        QDirIterator dirIt( QString::fromStdString(std::get<POOLDIRPATH>(currentPoolSettings))    /// reads from the pool directory and so on
-                          , filesExtensionFilter        /// evaluate only these file extensions
-                          , QDir::Files                 /// consider only files
-                          , QDirIterator::Subdirectories | QDirIterator::FollowSymlinks );  /// recurse sub-directory and evaluate sym-links
-
-        while(dirIt.hasNext())  {   /// outer loop: until file iterator reaches the end
-            for(unsigned int i = 0; i != threadsNumber; ++i )    {      /// loop to populate futureContainer with 30 std::future objects
-                const std::string& fileFullPathName = dirIt.next().toStdString();   /// fully qualified file name
-                futureContainer.emplace_front(std::async( XDGSearch::forEachFile    /// std::async calls forEachFile() function to create
-                                                       , fileFullPathName           /// a std::future object stored in futureContainer
-                                                       , helper ));
-                if( ! dirIt.hasNext())      /// if no more files to process then exit the loop
-                    break;
-            }
-            futureContainer.reverse();  /// it gives best results versus emplace_after() with before_begin iterator
-            for(auto& ftr : futureContainer)    {
-                const auto& pathAndCmdOutput = ftr.get();   /// it fetch results
-                ftr.~future();                              /// it destroys the future object
-                progressDialog.setValue(++numberOfFiles);   /// it increments numberOfFiles then pass the value to the dialog window
-                progressDialog.setLabelText(QObject::trUtf8("Indexing file number %1 of %n...", 0, nof).arg(numberOfFiles));
-                progressDialog.resize(300,100);     /// it resizes the dialog window to x:300, y:100 pixel
-
-
-                if (progressDialog.wasCanceled())   {   /// if the Cancel button of the progress dialog window is cliked then
-                    progressCanceled = true;            /// set progressCanceled to true then
-                    break;                              /// it exits the loop
-                }
-                const double&& progressBarValue = double(numberOfFiles) / nof * 100.;    /// it calculates the progress value in percent
-                emit progressValue(progressBarValue);   /// it emits signal caught by mainwindow progressBar object
-
-                unsigned int&&  linescounter = 0;     /// this variable keeps track of the document amount of lines
-                const unsigned int& granularity = std::get<GRANULARITY>(helper);    /// granularity stands for the amount of lines a document must have
-
-                std::istringstream issCmdOut(pathAndCmdOutput.second);  /// strigstream object, now holds the command standard output
-
-                for(std::string line, paragraph; ! issCmdOut.eof() ; /* null */ ) {  /// inner loop: for each line of the command's standard output
-                    getline(issCmdOut, line);
-                    if(!issCmdOut.eof() && line.empty())      /// avoids empty lines
-                        continue;
-
-                    if(!granularity)    {   /// if the user set to 0 then only first 15 lines are read, else...
-                        if(!paragraph.empty())
-                            paragraph += '\n';  /// if not empty then adds a new line
-
-                        paragraph += line;      /// adds the line to the paragraph
-                        ++linescounter;         /// increment the counter
-                        if (issCmdOut.eof() || (linescounter == 15)) {
-
-                            Xapian::Document doc;   /// defines an empty document
-                            doc.set_data(paragraph);     /// stores a 15 lines only paragraph into the document
-                            /// see: https://trac.xapian.org/wiki/FAQ/UniqueIds
-                            doc.add_term("P" + pathAndCmdOutput.first);     /// add fully qualified file name as "P" terms to the document
-
-                            indexer.set_document(doc);
-                            indexer.index_text(paragraph);
-                            tmpDB.add_document(doc);    /// add the document to the database
-                            break;      /// job done for this standard output, breaks in order to process a new one
-                        }
-                    } else {        /// ...else standard output will be split into blocks of granularity size
-                        if(!paragraph.empty())
-                            paragraph += '\n';      /// if not empty then adds a new line
-
-                        paragraph += line;          /// adds the line to the paragraph
-                        ++linescounter;             /// increment the counter
-                        if (issCmdOut.eof() || (linescounter == granularity)) {
-
-                            Xapian::Document doc;       /// defines an empty document
-                            doc.set_data(paragraph);    /// it stores the granularity amount of lines paragraph into the document
-                            doc.add_term("P" + pathAndCmdOutput.first);     /// add fully qualified file name as "P" terms to the document
-
-                            indexer.set_document(doc);
-                            indexer.index_text(paragraph);
-                            tmpDB.add_document(doc);    /// add the document to the database
-
-                            paragraph.clear();      /// reset the paragraph
-                            linescounter = 0;       /// reset the counter
-                        }
-                    }
-                }
+        tmpDBName = tempDir ->path().toStdString() + "/" + DBName;
+        Xapian::Database(DBName).compact(tmpDBName);
+    }
+    Xapian::WritableDatabase writableDB(singleFile ? tmpDBName : DBName, Xapian::DB_OPEN);
+    priorityApplied = XDGSearch::applyPriority(interactive ? XDGSearch::interactivePriority() : conf ->enqueryPriority());
+    std::vector<XDGSearch::helperType> poolHelpers;
+    std::vector<std::string> helpersExtensions;
+    enqueryPoolHelpers(poolHelpers, helpersExtensions);
+
+    /// kept in step with the database, so the next update of the pool doesn't index these files again
+    const std::string journalName = DBName + ".journal";
+    XDGSearch::Journal journal(std::get<POOLDIRPATH>(currentPoolSettings), walkingRulesSignature(helpersExtensions));
+    const bool&& journaled = journal.load(journalName);     /// without one the next update is a full rebuild anyway
+
+    Xapian::TermGenerator indexer;
+    const auto&& stopper = loadStopWords();
+    prepareTermGenerator(indexer, stopper.get());
+
+    XDGSearch::FileContext fileContext(writableDB);
+    std::vector<std::pair<std::string, unsigned int>> files;    /// files to index again with their helper index
+    for(const auto& c : changed)    {
+        std::vector<std::string> gone { c };    /// the file or each file below the directory
+        for(auto t = writableDB.allterms_begin("P" + c + "/"); t != writableDB.allterms_end("P" + c + "/"); ++t)
+            gone.push_back((*t).substr(1));
+        for(const auto& g : gone)
+            removeFile(writableDB, g);
+        std::string relName;    /// the pool relative name of c, it's empty for the pool directory
+        if(!journal.relativeName(c, relName))
+            continue;
+        if(journaled)
+            journal.forget(relName);
+
+        struct stat st;
+        if(::stat(c.c_str(), &st) != 0)     /// removed or moved away: nothing more to do
+            continue;
+        /// created, moved in or changed: walked from the pool directory, so the ancestors' ignore files and the depth apply
+        XDGSearch::Journal walked(std::get<POOLDIRPATH>(currentPoolSettings), 0);  /// never saved, its directories are grafted into the pool's journal
+        bool wanted = false;
+        {
+            XDGSearch::Walker dirIt(std::get<POOLDIRPATH>(currentPoolSettings), helpersExtensions, currentWalkerSettings, 0, nullptr, &walked, relName);
+            while(dirIt.hasNext())  {
+                std::string f = dirIt.next();
+                files.emplace_back(std::move(f), dirIt.getHelper());
+                wanted = true;
             }
-            futureContainer.clear();
-            if(progressCanceled)
-                break;
         }
-    if(progressCanceled)
-        break;
-    }
-    if(progressCanceled)    {
-        tmpDB.close();
-        return false;
+        if(!journaled)
+            continue;
+        if(S_ISDIR(st.st_mode))
+            journal.graft(walked);
+        else if(wanted)    {   /// the record a scan would write, in the journal of its directory
+            const std::size_t&& slash = relName.rfind('/');
+            journal.recordFile( slash == std::string::npos ? std::string() : relName.substr(0, slash)
+                              , { slash == std::string::npos ? relName : relName.substr(slash + 1)
+                                , st.st_mtim.tv_sec * 1000000000ll + st.st_mtim.tv_nsec
+                                , static_cast<unsigned long long>(st.st_size)
+                                , static_cast<unsigned long long>(st.st_dev), st.st_ino } );
+        }
     }
 
-    tmpDB.commit();
-    tmpDB.compact(DBName);    /// writes compacted database from /tmp to $HOME/.local/share/XDGSearch/xdgsearch
-    tmpDB.close();
-
+    XDGSearch::TextCache textCache("./textcache", conf ->textCacheSize());
+    XDGSearch::ContentClaims claims;
+    std::vector<XDGSearch::extractionType> sameContent;
+    const unsigned int&& threadsNumber = XDGSearch::Concurrency(DBName, conf ->concurrentHelpers()).limit();   /// a few files: no time to tune it
+    for(std::size_t first = 0; first < files.size(); first += threadsNumber)   {
+        std::vector<std::future<XDGSearch::extractionType>> futures;
+        for(std::size_t i = first; i != files.size() && i != first + threadsNumber; ++i)
+            futures.push_back(std::async(XDGSearch::forEachFile, files[i].first, poolHelpers[files[i].second], &textCache, &claims, journaled ? &journal : nullptr, nullptr, nullptr));
+        for(std::size_t i = 0; i != futures.size(); ++i)    {
+            auto&& extraction = futures[i].get();
+            if(!attachFile(writableDB, extraction)) {
+                if(std::get<SAMECONTENT>(extraction))
+                    sameContent.push_back(extraction);
+                else
+                    indexDocuments(writableDB, indexer, extraction, std::get<GRANULARITY>(poolHelpers[files[first + i].second]), fileContext);
+            }
+            XDGSearch::BufferPool::shared().give(std::move(std::get<HELPEROUTPUT>(extraction)));
+        }
+    }
+    for(const auto& e : sameContent)
+        attachFile(writableDB, e);
+    writableDB.commit();
+    if(singleFile || needsCompaction(DBName))
+        compactDB(writableDB, DBName);
+    if(journaled)
+        journal.save(journalName);  /// only once the database holds what the journal tells
     return true;
 }
+    catch(const Xapian::DatabaseLockError&)  {     /// a build or another update is running: the caller retries later
+        return false;
+    }
+    catch(const Xapian::DatabaseNotFoundError&)  {     /// never built: there is nothing to keep up to date
+        return true;
+    }
     catch(const Xapian::Error& e)  {
         std::cerr << e.get_description() << std::endl;
         exit(EXIT_FAILURE);
@@ -251,50 +582,336 @@ try {
     }
 }
 
-std::pair<std::string, std::string> XDGSearch::forEachFile(const std::string& fileFullPathName
-                                       , const XDGSearch::helperType& h)
+void XDGSearch::IndexerBase::indexDocuments( Xapian::WritableDatabase& db
+                                           , Xapian::TermGenerator& indexer
+                                           , const XDGSearch::extractionType& extraction
+                                           , unsigned int granularity    /// granularity stands for the amount of lines a document must have
+                                           , XDGSearch::FileContext& context ) const
+{
+    const auto&& t0 = std::chrono::steady_clock::now();
+    unsigned long long xapianTime = 0;      /// index_text() and add_document(), they're taken off the splitting time
+    const std::string& fileName = std::get<FILENAME>(extraction);
+    const std::string& contentTerm = std::get<CONTENTTERM>(extraction);
+    const unsigned long long&& allocations = XDGSearch::BuildStats::allocations();
+    const XDGSearch::StemCache::Counters&& stemCounters = XDGSearch::StemCache::counters();
+    unsigned long long paragraphs = 0;
+    context.begin(fileName);
+    const auto store = [&] (const char* paragraph, std::size_t size)    {
+        Xapian::Document& doc = context.next();     /// the document of the previous paragraph, emptied
+        doc.set_data(context.encode(paragraph, size));     /// stores the paragraph, compressed, into the document
+        doc.add_term(context.getPathTerm());    /// add fully qualified file name as "P" terms to the document
+        if(!contentTerm.empty())
+            doc.add_term(contentTerm);    /// files with the same contents are attached to this document
+
+        indexer.set_document(doc);
+        {
+            const XDGSearch::BuildStats::Timer t(stats, XDGSearch::BuildStats::INDEXTEXT);
+            if(positions)   /// straight from the helper output, no copy
+                indexer.index_text(Xapian::Utf8Iterator(paragraph, size));
+            else
+                indexer.index_text_without_positions(Xapian::Utf8Iterator(paragraph, size));
+            xapianTime += stats ? t.elapsed() : 0;
+        }
+        const XDGSearch::BuildStats::Timer t(stats, XDGSearch::BuildStats::ADDDOCUMENT);
+        db.add_document(doc);    /// add the document to the database
+        xapianTime += stats ? t.elapsed() : 0;
+        ++paragraphs;
+    };
+
+    /// the standard output is split into paragraphs of granularity lines, 0 means only the first 15 lines
+    XDGSearch::Chunker chunker(std::get<HELPEROUTPUT>(extraction), granularity);
+    while(chunker.next())
+        store(chunker.data(), chunker.size());
+
+    if(stats)   {
+        stats ->add( XDGSearch::BuildStats::SPLIT
+                   , std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count() - xapianTime );
+        stats ->addCounter("paragraphs", paragraphs);
+        if(XDGSearch::BuildStats::countsAllocations)
+            stats ->addCounter("paragraphAllocations", XDGSearch::BuildStats::allocations() - allocations);
+        const XDGSearch::StemCache::Counters&& c = XDGSearch::StemCache::counters();
+        const unsigned long long&& misses = c.misses - stemCounters.misses, hits = c.hits - stemCounters.hits;
+        stats ->addCounter("stemCacheHits", hits);
+        stats ->addCounter("stemCacheMisses", misses);
+        if(misses)      /// each hit would have taken as long as the average miss
+            stats ->addCounter("stemSavedNanoseconds", hits * (c.missNanoseconds - stemCounters.missNanoseconds) / misses);
+    }
+}
+
+void XDGSearch::IndexerBase::removeFile(Xapian::WritableDatabase& db, const std::string& fileName) const
+{
+    const std::string&& pathTerm = "P" + fileName;
+    std::vector<Xapian::docid> ids;     /// gathered first, the posting list changes while documents are replaced
+    for(auto p = db.postlist_begin(pathTerm); p != db.postlist_end(pathTerm); ++p)
+        ids.push_back(*p);
+    for(const auto& id : ids)   {
+        Xapian::Document doc = db.get_document(id);
+        unsigned int paths = 0;
+        auto t = doc.termlist_begin();
+        for(t.skip_to("P"); t != doc.termlist_end() && (*t)[0] == 'P' && paths != 2; ++t)
+            ++paths;
+        if(paths > 1)   {   /// other files have the same contents: the document stays for them
+            doc.remove_term(pathTerm);
+            db.replace_document(id, doc);
+        } else
+            db.delete_document(id);
+    }
+}
+
+bool XDGSearch::IndexerBase::attachFile(Xapian::WritableDatabase& db, const XDGSearch::extractionType& extraction) const
+{
+    const std::string& contentTerm = std::get<CONTENTTERM>(extraction);
+    if(contentTerm.empty() || !db.term_exists(contentTerm))
+        return false;
+    std::vector<Xapian::docid> ids;
+    for(auto p = db.postlist_begin(contentTerm); p != db.postlist_end(contentTerm); ++p)
+        ids.push_back(*p);
+    for(const auto& id : ids)   {
+        Xapian::Document doc = db.get_document(id);
+        doc.add_term("P" + std::get<FILENAME>(extraction));
+        db.replace_document(id, doc);
+    }
+    return true;
+}
+
+XDGSearch::extractionType XDGSearch::forEachFile(const std::string& fileFullPathName
+                                       , const XDGSearch::helperType& h
+                                       , XDGSearch::TextCache* cache
+                                       , XDGSearch::ContentClaims* claims
+                                       , XDGSearch::Journal* journal
+                                       , XDGSearch::BudgetSlot* slot
+                                       , XDGSearch::BuildStats* stats)
 {
+    const XDGSearch::Trace::Span span("extract", fileFullPathName);
+    const auto&& t0 = std::chrono::steady_clock::now();
+    const auto record = [&] (unsigned long long bytes)  {   /// per helper and per extension figures
+        if(stats)
+            stats ->addFile( std::get<HELPERNAME>(h), fileFullPathName
+                           , std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count()
+                           , bytes );
+    };
+    std::string contentTerm;    /// files are told apart by contents, not by name: copies are extracted once
+    uint64_t contentHash;
+    struct stat st;
+    bool hashed = false;
+    if(::stat(fileFullPathName.c_str(), &st) == 0)  {   /// read in full only if it changed since it was last hashed
+        const auto&& key = XDGSearch::Journal::keyOf(st);
+        hashed = journal && journal ->findHash(key, contentHash);
+        if(!hashed && XDGSearch::hashFile(fileFullPathName, contentHash))    {
+            hashed = true;
+            if(journal)
+                journal ->recordHash(key, contentHash);
+        }
+    }
+    if(hashed)  {
+        contentTerm = "H" + XDGSearch::toHex(contentHash) + XDGSearch::toHex(XDGSearch::hashString(std::get<COMMANDLINE>(h)));
+        if(claims && !claims ->claim(contentTerm))  /// another thread extracts the same contents
+            return std::make_tuple(fileFullPathName, std::string(), contentTerm, true);
+    }
+
+    std::string cacheKey;       /// the helper runs only if the same contents weren't extracted by the same command line
+    if(!contentTerm.empty() && cache && cache ->isEnabled())  {
+        cacheKey = XDGSearch::TextCache::key(contentHash, st.st_size, std::get<COMMANDLINE>(h));
+        std::string cached;
+        if(cache ->find(cacheKey, cached))  {
+            if(slot)
+                slot ->acquire(cached.size());
+            record(cached.size());
+            return std::make_tuple(fileFullPathName, std::move(cached), contentTerm, false);
+        }
+    }
+
     const std::string cmd = std::get<COMMANDLINE>(h)         /// start command line with command name
             + " \""                  /// surrounds the arguments with quotation marks: ""
             + fileFullPathName
             + "\"";
 
-    std::string cmdStdOut;      /// container that'll hold the command's standard output
+    std::string cmdStdOut = XDGSearch::BufferPool::shared().take();     /// container that'll hold the command's standard output
+
+    {
+        const XDGSearch::BuildStats::Timer helperRun(stats, XDGSearch::BuildStats::HELPERRUN);
+        FILE* pipe;
+        {
+            const XDGSearch::BuildStats::Timer spawn(stats, XDGSearch::BuildStats::SPAWN);
+            pipe = popen(cmd.c_str(), "r");   /// runs the command
+        }
+        /// may returns this error message: "Syntax error: EOF in backquote substitution"
+        /// if so the filename (fileFullPathName) may contains characters that they needed to be escaped
+        /// like backtick ` FYI
+
+        {
+            const XDGSearch::BuildStats::Timer pipeRead(stats, XDGSearch::BuildStats::PIPEREAD);
+            char buffer[65536];
+            for(std::size_t len; (len = fread(buffer, 1, sizeof buffer, pipe)) != 0; /* null */)   {
+                if(slot)
+                    slot ->acquire(len);    /// a full budget leaves the helper blocked on the pipe
+                cmdStdOut.append(buffer, len);      /// it reads the command standard output
+            }
+        }
+        pclose(pipe);
+    }
+    record(cmdStdOut.size());
+    if(!cacheKey.empty())
+        cache ->store(cacheKey, cmdStdOut);
+
+    return std::make_tuple(fileFullPathName, std::move(cmdStdOut), contentTerm, false);
+}
+
+XDGSearch::ByteBudget& XDGSearch::ByteBudget::shared()
+{
+    static ByteBudget budget;
+    return budget;
+}
+
+void XDGSearch::ByteBudget::setLimit(unsigned long long l)
+{
+    std::lock_guard<std::mutex> lk(m);
+    limit = l;
+    cv.notify_all();
+}
+
+bool XDGSearch::ByteBudget::isExhausted()
+{
+    std::lock_guard<std::mutex> lk(m);
+    return limit && inUse >= limit;
+}
+
+unsigned long long XDGSearch::ByteBudget::getPeak()
+{
+    std::lock_guard<std::mutex> lk(m);
+    return peak;
+}
+
+XDGSearch::BudgetSlot::BudgetSlot( XDGSearch::ByteBudget& b
+                                 , const std::atomic<unsigned long long>& h
+                                 , unsigned long long t ) :
+      budget(b)
+    , head(h)
+    , ticket(t)
+    , held(0)
+{
+}
+
+void XDGSearch::BudgetSlot::acquire(unsigned long long n)
+{
+    std::unique_lock<std::mutex> lk(budget.m);
+    budget.cv.wait(lk, [&] { return !budget.limit || budget.inUse + n <= budget.limit || head == ticket; });
+    budget.inUse += n;
+    held += n;
+    if(budget.inUse > budget.peak)
+        budget.peak = budget.inUse;
+}
+
+void XDGSearch::BudgetSlot::release()
+{
+    std::lock_guard<std::mutex> lk(budget.m);   /// even with nothing held: the oldest ticket may have moved and must be seen
+    budget.inUse -= held;
+    held = 0;
+    budget.cv.notify_all();
+}
+
+XDGSearch::BufferPool& XDGSearch::BufferPool::shared()
+{
+    static BufferPool pool;
+    return pool;
+}
+
+std::string XDGSearch::BufferPool::take()
+{
+    std::lock_guard<std::mutex> lk(m);
+    if(buffers.empty())
+        return std::string();
+    std::string retval = std::move(buffers.back());
+    buffers.pop_back();
+    return retval;
+}
+
+void XDGSearch::BufferPool::give(std::string&& s)
+{
+    if(s.capacity() > (1 << 20))    /// a huge output isn't worth keeping
+        return;
+    s.clear();
+    std::lock_guard<std::mutex> lk(m);
+    if(buffers.size() < 16)
+        buffers.push_back(std::move(s));
+}
+
+XDGSearch::FileContext::FileContext(Xapian::WritableDatabase& db) :
+    encoder(new XDGSearch::TextEncoder(db))
+{
+}
+
+XDGSearch::FileContext::~FileContext() = default;
+
+const std::string& XDGSearch::FileContext::encode(const char* paragraph, std::size_t size)
+{
+    encoder ->encode(paragraph, size, data);
+    return data;
+}
+
+void XDGSearch::FileContext::begin(const std::string& fileName)
+{
+    pathTerm.assign(1, 'P').append(fileName);   /// see: https://trac.xapian.org/wiki/FAQ/UniqueIds
+}
 
-    FILE* pipe = popen(cmd.c_str(), "r");   /// runs the command
-    /// may returns this error message: "Syntax error: EOF in backquote substitution"
-    /// if so the filename (fileFullPathName) may contains characters that they needed to be escaped
-    /// like backtick ` FYI
+Xapian::Document& XDGSearch::FileContext::next()
+{
+    doc.clear_terms();      /// the data is overwritten by set_data(), no values are set
+    return doc;
+}
 
-    for(char buffer[512]; !feof(pipe); /* null */)
-        if (fgets(buffer, 512, pipe) != NULL)
-            cmdStdOut += buffer;        /// it reads the command standard output
+XDGSearch::UpdateLock::UpdateLock(const std::string& DBName, bool wait) :
+    fd(::open((DBName + ".lock").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644))
+{
+    int r = -1;
+    if(fd >= 0)
+        while((r = ::flock(fd, wait ? LOCK_EX : LOCK_EX | LOCK_NB)) != 0 && errno == EINTR)
+            ;   /// interrupted by a signal while waiting
+    if(r != 0)  {
+        if(fd >= 0)
+            ::close(fd);
+        throw Xapian::DatabaseLockError("Unable to get write lock on " + DBName + ": already locked");
+    }
+}
 
-    pclose(pipe);
+XDGSearch::UpdateLock::~UpdateLock()
+{
+    ::close(fd);    /// the lock goes with it
+}
 
-    return { fileFullPathName, cmdStdOut };     /// under c++11 we can list initialize the return value
+unsigned long long XDGSearch::peakRSS()
+{
+    struct rusage ru;
+    if(::getrusage(RUSAGE_SELF, &ru) != 0)
+        return 0;
+    return static_cast<unsigned long long>(ru.ru_maxrss) * 1024;  /// Linux tells kilobytes
 }
 
-const Xapian::MSet XDGSearch::IndexerBase::enqueryDB(const std::string& query_string) const
+const Xapian::MSet XDGSearch::IndexerBase::enqueryDB(const std::string& query_string, unsigned int maxItems) const
 {
 try {
     /// Open the database for searching.
     Xapian::Database db(std::get<LOCALPOOLNAME>(currentPoolSettings));
+    encodedText = XDGSearch::loadDictionary(db);    /// the paragraphs of the matches are inflated with it
 
     /// Start an enquire session.
     Xapian::Enquire enquire(db);
 
     /// Parse the query string to produce a Xapian::Query object.
     Xapian::QueryParser qp;
-    Xapian::Stem stemmer(std::get<STEMMING>(currentPoolSettings));
-    qp.set_stemmer(stemmer);
+    qp.set_stemmer(XDGSearch::cachedStem(std::get<STEMMING>(currentPoolSettings)));   /// the words stemmed by the last queries are cached
     qp.set_database(db);
     qp.set_stemming_strategy(Xapian::QueryParser::STEM_SOME);
+    const auto&& stopper = loadStopWords();     /// the stop-words weren't indexed, they are not sought either
+    if(stopper)
+        qp.set_stopper(stopper.get());
     Xapian::Query query = qp.parse_query(query_string);
+    if(!db.has_positions())     /// a pool indexed without positions: the words of a phrase are sought anywhere in the paragraph
+        query = withoutPhrases(query);
 
-    /// Find the top 10 results for the query.
+    /// Find the top maxItems results for the query.
     enquire.set_query(query);
-    Xapian::MSet matches = enquire.get_mset(0, 10);
+    Xapian::MSet matches = enquire.get_mset(0, maxItems);
 
     return matches;
     }
@@ -321,6 +938,18 @@ try {
                          << "<p style=\"-qt-paragraph-type:empty; margin-top:0px; margin-bottom:0px; margin-left:0px; margin-right:0px; -qt-block-indent:0; text-indent:0px;\"><br /></p>"
                          << "<p align=\"center\" style=\" margin-top:0px; margin-bottom:0px; margin-left:0px; margin-right:0px; -qt-block-indent:0; text-indent:0px;\"><span style=\" font-size:12pt; font-weight:600; color:#bababa;\">No items found</span></p></body></html>";
         else    {           /// matches has documents, starts formatting
+            std::vector<std::string> sought;    /// each term but the last one is bolded when followed by a space or an underscore
+            std::istringstream issTerms(soughtTerms);
+            for(std::string term; issTerms >> term; /* null */) {
+                term = XDGSearch::escapeHtml(term);     /// it's sought in the escaped text
+                if(issTerms.eof())
+                    sought.push_back(term);
+                else    {
+                    sought.push_back(term + " ");
+                    sought.push_back(term + "_");
+                }
+            }
+            const XDGSearch::TermScanner scanner(sought);
             for( Xapian::MSetIterator matchesIterator = matches.begin()
                ; matchesIterator != matches.end()
                ; ++matchesIterator) {
@@ -338,63 +967,20 @@ try {
                         linkPath = "file://";           /// "baz.pdf" both useful when compose the HTML formatted answer to the query
                     else
                         linkPath = linkPath + "/" + linkName;
-                /// retrieve the data of the document pointed by the iterator
-                QString documentText = QString::fromStdString(matchesIterator.get_document().get_data());
-
-                documentText.replace("&","&amp;");  /// in documentText replaces HTML reserved characters
-                documentText.replace("<","&lt;");
-                documentText.replace(">","&gt;");
-                iss.clear();
-                iss.str(soughtTerms);       /// recycle iss object now it holds the terms to search
-                /// iteration to achieve bolded sought terms effect when documentText will be added to composeHTML
-                for( std::string term, term1
-                   ; iss >> term
-                   ; /* null */)
-                {
-                    term1 = term;
-                    if ( ! iss.eof())
-                        term += " ";        /// if it isn't the last term, it adds a trailing space to the sought term
-
-                    for( decltype(documentText.indexOf(QString(""))) pos = documentText.indexOf(QString::fromStdString(term), 0, Qt::CaseInsensitive)
-                       ; pos != -1
-                       ; /* null */)
-                    {
-                        documentText.insert(pos, "<span style=\" font-weight:600;\">"); /// it adds bold effect syntax
-                        pos = documentText.indexOf( QString::fromStdString(term)
-                                                  , pos
-                                                  , Qt::CaseInsensitive); /// position at the term is located
-                        pos += term.size();     /// advance pos cursor of the term size
-                        documentText.insert(pos, "</span>");    /// now pos it's after the term so insert the syntax needed for the bold effect
-                        ++pos;  /// advance pos cursor so if there is another identical term will be located from the next statement
-                        pos = documentText.indexOf( QString::fromStdString(term)
-                                                  , pos
-                                                  , Qt::CaseInsensitive);   /// looks for term again, if not found pos == -1 therefore quitting this loop
-                    }
-                    if ( ! iss.eof())
-                        term1 += "_";       /// if it isn't the last term, it adds a trailing underscore to the sought term
-
-                    for( decltype(documentText.indexOf(QString(""))) pos = documentText.indexOf(QString::fromStdString(term1), 0, Qt::CaseInsensitive)
-                       ; pos != -1
-                       ; /* null */)
-                    {
-                        documentText.insert(pos, "<span style=\" font-weight:600;\">"); /// it adds bold effect syntax
-                        pos = documentText.indexOf( QString::fromStdString(term1)
-                                                  , pos
-                                                  , Qt::CaseInsensitive); /// position at the term is located
-                        pos += term1.size();     /// advance pos cursor of the term size
-                        documentText.insert(pos, "</span>");    /// now pos it's after the term so insert the syntax needed for the bold effect
-                        ++pos;  /// advance pos cursor so if there is another identical term will be located from the next statement
-                        pos = documentText.indexOf( QString::fromStdString(term1)
-                                                  , pos
-                                                  , Qt::CaseInsensitive);   /// looks for term again, if not found pos == -1 therefore quitting this loop
-                    }
-                }
-                iss.clear();
-                iss.str(documentText.toStdString());
-                for(std::string line; std::getline(iss, line); /* null */)
+                /// retrieve the data of the document pointed by the iterator, HTML reserved characters are replaced
+                /// and the sought terms are bolded, on the UTF-8 bytes
+                const std::string&& documentText = XDGSearch::highlightTerms( XDGSearch::escapeHtml(XDGSearch::documentText(matchesIterator.get_document().get_data(), encodedText))
+                                                                            , scanner
+                                                                            , "<span style=\" font-weight:600;\">"
+                                                                            , "</span>" );
+                for(std::size_t pos = 0, end; pos < documentText.size(); pos = end + 1)    /// a paragraph for each line
                 {
-                    paragraphDocument += "<p style=\" margin-top:0px; margin-bottom:0px; margin-left:0px; margin-right:0px; -qt-block-indent:0; text-indent:0px;\">"
-                                      + line + "</p>";
+                    end = documentText.find('\n', pos);
+                    if(end == std::string::npos)
+                        end = documentText.size();
+                    paragraphDocument.append("<p style=\" margin-top:0px; margin-bottom:0px; margin-left:0px; margin-right:0px; -qt-block-indent:0; text-indent:0px;\">")
+                                     .append(documentText, pos, end - pos)
+                                     .append("</p>");
                 }
                 composeHTML << "<p style=\" margin-top:0px; margin-bottom:0px; margin-left:0px; margin-right:0px; -qt-block-indent:0; text-indent:0px;\"><a href="
                 /// surrounds linkPath with quotation marks so it'll be legal also if it contains white spaces
@@ -22,40 +22,186 @@
 #include <memory>
 #include <xapian.h>
 #include <forward_list>
+#include <vector>
+#include <tuple>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_set>
 #include <QTemporaryDir>
-#include <QWidget>
+#include <QObject>
 #include "configuration.h"
 
 namespace XDGSearch {
 class IndexerBase;          /// "Cheshire Cat" implemention class for Indexer class
 class Indexer;              /// Interface class for indexing/quering  operation
-std::pair<std::string, std::string> forEachFile(const std::string&
-               , const XDGSearch::helperType& );    /// threaded function to populate each pool's database
+class TextCache;
+class Journal;
+class BuildStats;
+class ContentClaims;        /// thread safe set of the contents already handed to a helper during a build
+class ByteBudget;           /// bound of the helpers' output held in memory by all the builds of the process
+class BudgetSlot;           /// the share of the budget held by one extraction
+class BufferPool;           /// helpers' output strings handed back once stored, the next extractions read into them
+class StopWords;
+class UpdateLock;           /// one writer at a time of a pool's database, swaps included
+class TextEncoder;
+class FileContext;          /// what indexDocuments() keeps from a paragraph to the next and from a file to the next
+unsigned long long peakRSS();   /// the most resident memory the process used so far, bytes
+
+using extractionType = std::tuple<std::string   ///  0 file name
+                                , std::string   ///  1 helper output
+                                , std::string   ///  2 content term
+                                , bool>;        ///  3 same content
+enum {
+      FILENAME          /// fully qualified name of the extracted file
+    , HELPEROUTPUT      /// the helper's standard output
+    , CONTENTTERM       /// "H" term: hash of the file contents and of the helper command line, empty if the file can't be read
+    , SAMECONTENT       /// true when a file with the same contents was claimed by another extraction: the helper didn't run
+};
+
+XDGSearch::extractionType forEachFile(const std::string&
+               , const XDGSearch::helperType&
+               , XDGSearch::TextCache*
+               , XDGSearch::ContentClaims*
+               , XDGSearch::Journal*                /// the contents hashes known, the new ones are added
+               , XDGSearch::BudgetSlot*
+               , XDGSearch::BuildStats* );          /// threaded function to populate each pool's database, the last five may be nullptr
 }
 
-class XDGSearch::IndexerBase final : public QWidget {
+/// Helper output is charged to the budget while it's read from the pipe, and stays charged until the document
+/// is stored. Extractions wait while the budget is exhausted, but the oldest one of each build, the one the build
+/// is waiting for, always goes on: so builds can't deadlock and a single output bigger than the budget still fits.
+class XDGSearch::ByteBudget final  {
+friend class BudgetSlot;
+public:
+    static ByteBudget& shared();            /// the pools rebuilt at once share the same budget
+    void setLimit(unsigned long long);      /// bytes, 0 means no limit
+    bool isExhausted();                     /// true when a new extraction shouldn't start
+    unsigned long long getPeak();           /// the most bytes held at once since the process started
+private:
+    ByteBudget() = default;
+    std::mutex m;
+    std::condition_variable cv;
+    unsigned long long limit = 0, inUse = 0, peak = 0;
+};
+
+class XDGSearch::BudgetSlot final  {
+public:
+    BudgetSlot( ByteBudget&
+              , const std::atomic<unsigned long long>&  /// ticket of the oldest extraction of the build
+              , unsigned long long );                   /// ticket of this extraction
+    BudgetSlot(BudgetSlot&&) = delete;
+    BudgetSlot& operator=(BudgetSlot&&) = delete;
+    ~BudgetSlot()       { release(); }
+    void acquire(unsigned long long);       /// charge more bytes, it waits while the budget is exhausted
+    void release();                         /// give back all the bytes charged so far
+private:
+    ByteBudget& budget;
+    const std::atomic<unsigned long long>& head;
+    const unsigned long long ticket;
+    unsigned long long held;
+};
+
+/// A recycled string keeps its capacity: the output of the next helper doesn't grow from nothing. The pool keeps a
+/// few strings, up to 1 MiB each, so the memory it holds stays small next to the budget.
+class XDGSearch::BufferPool final  {
+public:
+    static BufferPool& shared();            /// the builds of the process share the same pool
+    std::string take();                     /// thread safe, an empty string, recycled when there is one
+    void give(std::string&&);               /// thread safe
+private:
+    BufferPool() = default;
+    std::mutex m;
+    std::vector<std::string> buffers;
+};
+
+/// Reset, not freed, between paragraphs and files: the document keeps its data string, the path term, the data
+/// buffer and the compressor keep their capacity, so storing a paragraph allocates little more than what Xapian does
+class XDGSearch::FileContext final  {
+public:
+    explicit FileContext(Xapian::WritableDatabase&);    /// the database the paragraphs are stored into
+    FileContext(FileContext&&) = delete;
+    FileContext& operator=(FileContext&&) = delete;
+    ~FileContext();
+    void begin(const std::string&);         /// a new file: the path term is rebuilt in place
+    Xapian::Document& next();               /// the document, emptied of the previous paragraph
+    const std::string& encode(const char*, std::size_t);    /// the data of the paragraph handed to set_data()
+    const std::string& getPathTerm() const  { return pathTerm; }
+    const XDGSearch::TextEncoder& getEncoder() const    { return *encoder; }
+private:
+    Xapian::Document doc;
+    std::string pathTerm, data;
+    std::unique_ptr<XDGSearch::TextEncoder> encoder;
+};
+
+/// A build writes into the staging directory and a compaction packs the database aside, then both swap the result
+/// in: the Xapian lock of the database doesn't cover them. The lock file beside it keeps builds, compactions and
+/// watcher updates of a pool from running at once, whether the database is a directory or a single file.
+class XDGSearch::UpdateLock final  {
+public:
+    UpdateLock(const std::string&, bool wait = false);  /// database name, unless waiting it throws Xapian::DatabaseLockError while held
+    UpdateLock(UpdateLock&&) = delete;
+    UpdateLock& operator=(UpdateLock&&) = delete;
+    ~UpdateLock();
+private:
+    int fd;
+};
+
+class XDGSearch::ContentClaims final  {
+public:
+    bool claim(const std::string& t)    { std::lock_guard<std::mutex> lk(m); return claimed.insert(t).second; }  /// true for the first claimer only
+private:
+    std::mutex m;
+    std::unordered_set<std::string> claimed;
+};
+
+/// No user interface here: the progress is told through signals, so the same code serves the GUI and the command line
+class XDGSearch::IndexerBase final : public QObject {
     Q_OBJECT
 friend class Indexer;
     class queryResult;      /// nested class to provide answer for sought terms
-    IndexerBase(QWidget*, const Pool&);
-    bool populateDB();      /// build database for the current pool
+    IndexerBase(QObject*, const Pool&);
+    bool populateDB(bool);  /// build database for the current pool, or update it when true
+    bool updateFiles(const std::vector<std::string>&);  /// replace the documents of the given files and directories
+    void enqueryPoolHelpers(std::vector<XDGSearch::helperType>&, std::vector<std::string>&) const;  /// the pool's helpers and their extensions
+    std::shared_ptr<const XDGSearch::StopWords> loadStopWords() const;   /// the stop-words of the pool, nullptr if none
+    void prepareTermGenerator(Xapian::TermGenerator&, const XDGSearch::StopWords*) const;   /// stemming and stop-words of the pool
+    void indexDocuments( Xapian::WritableDatabase&      /// split a helper output into documents
+                       , Xapian::TermGenerator&
+                       , const XDGSearch::extractionType&
+                       , unsigned int
+                       , XDGSearch::FileContext& ) const;
+    QString stagingTemplate(const std::string&) const;  /// where the database is built before it's compacted into place
+    void compactDB(Xapian::Database&, const std::string&) const;  /// packs the database aside as the pool's settings tell, then swaps it in
+    bool needsCompaction(const std::string&) const;     /// true when an updated database grew too much since its compaction
+    unsigned long long walkingRulesSignature(const std::vector<std::string>&) const;    /// of the journals, from the helpers' extensions
+    bool attachFile(Xapian::WritableDatabase&, const XDGSearch::extractionType&) const;    /// false if no document has the same contents
+    void removeFile(Xapian::WritableDatabase&, const std::string&) const;  /// the documents of a file, or just its path when shared
     void forEachHelper( const XDGSearch::helperType&
                       , const XDGSearch::poolType&
                       , Xapian::WritableDatabase* );
     void seek(const std::string&);  /// build a queryresult object and write result to htmlResult string
-    const Xapian::MSet enqueryDB(const std::string&) const; /// find a string in the current pool's database
-    unsigned int determineNumberOfFiles();  /// counts the number of files to index
+    const Xapian::MSet enqueryDB(const std::string&, unsigned int = 10) const; /// find a string in the current pool's database
     std::unique_ptr<XDGSearch::Configuration> const conf;
     XDGSearch::poolType currentPoolSettings;
+    XDGSearch::walkerType currentWalkerSettings;
     std::string xdgKey, htmlResult;
     unsigned int numberOfFiles;     /// stores the number of files processed during database building
+    unsigned int sameContentFiles;  /// files attached to the documents of another file with the same contents
+    std::atomic<bool> canceled;     /// set by cancel(), populateDB() returns false as soon as it sees it
+    bool interactive;               /// the user is waiting: normal priority instead of the background one
+    bool priorityApplied;           /// false if the kernel refused some of the priority of the last build or update
+    XDGSearch::BuildStats* stats;   /// the instrumentation of the running populateDB(), else nullptr
+    const bool positions;           /// the pool's text is indexed with its positions, phrase queries need them
+    mutable bool encodedText;       /// set by enqueryDB(): the data of the matches is in the format of doctext.h
 signals:
     void progressValue(int);
+    void progress(unsigned int, unsigned int, bool);    /// files indexed, files found, true while still crawling
 };
 
 class XDGSearch::IndexerBase::queryResult final   {
 public:
-    queryResult(const std::string&, const Xapian::MSet&);   /// ctor that handle the query answers
+    queryResult(const std::string&, const Xapian::MSet&, bool);     /// ctor that handle the query answers, true if the pool is encoded
     queryResult(queryResult&&) = delete;
     queryResult& operator=(queryResult&&) = delete;
     ~queryResult() = default;
@@ -63,32 +209,43 @@ public:
 private:
     std::string composeResult(const Xapian::MSet&);     /// translate the query answer to an html formatted string
     std::string htmlResult, soughtTerms;
+    const bool encodedText;
 };
 
-class XDGSearch::Indexer final : public QWidget {
+class XDGSearch::Indexer final : public QObject {
     Q_OBJECT
 public:
-    Indexer(QWidget*, const XDGSearch::Pool&);
+    Indexer(QObject*, const XDGSearch::Pool&);
     Indexer(Indexer&&) = delete;
     Indexer& operator=(Indexer&&) = delete;
     ~Indexer();
-    bool populateDB() const                 { return d ->populateDB(); }
+    bool populateDB(bool incremental = false) const { return d ->populateDB(incremental); }  /// when true only changed files are indexed
+    bool updateFiles(const std::vector<std::string>& c) const   { return d ->updateFiles(c); }  /// false when the database is busy
+    void cancel() const                     { d ->canceled = true; }     /// stop a running populateDB(), it can be called from a progress signal
+    void setInteractive(bool b) const       { d ->interactive = b; }    /// read when populateDB() or updateFiles() start
+    bool isPriorityApplied() const          { return d ->priorityApplied; }     /// false if the kernel refused it, e.g. raising it back
+    unsigned int getIndexedFiles() const    { return d ->numberOfFiles; }
     void seek(const std::string& s) const   { d ->seek(s); }
     std::string getResult() const           { return d ->htmlResult; }
+    const Xapian::MSet enqueryDB(const std::string& s, unsigned int n = 10) const   { return d ->enqueryDB(s, n); }   /// the n best matches
+    std::string composeResult(const std::string& s, const Xapian::MSet& m) const    { return IndexerBase::queryResult(s, m, d ->encodedText).getResult(); }  /// the html of matches of the terms s
+    std::string documentText(const Xapian::Document&) const;   /// the paragraph of a match of the last enqueryDB()
 signals:
     void progressValue(int);
+    void progress(unsigned int, unsigned int, bool);
 private:
     XDGSearch::IndexerBase* const d;
 };
 
 inline
-XDGSearch::IndexerBase::queryResult::queryResult(const std::string& s, const Xapian::MSet& m) :
-    soughtTerms(s)  { htmlResult = composeResult(m); }
+XDGSearch::IndexerBase::queryResult::queryResult(const std::string& s, const Xapian::MSet& m, bool e) :
+    soughtTerms(s), encodedText(e)  { htmlResult = composeResult(m); }
 
 inline
 void XDGSearch::IndexerBase::seek(const std::string& s)
 {
-    const XDGSearch::IndexerBase::queryResult qr(s, enqueryDB(s));
+    const Xapian::MSet&& matches = enqueryDB(s);    /// it tells the format of their data first
+    const XDGSearch::IndexerBase::queryResult qr(s, matches, encodedText);
     htmlResult = qr.getResult();
 }
 
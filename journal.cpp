@@ -0,0 +1,289 @@
+/* XDGSearch is a XAPIAN based file indexer and search tool.
+
+    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "journal.h"
+#include <fstream>
+#include <unordered_set>
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+
+namespace {
+const char journalMagic[8] = { 'X', 'D', 'G', 'J', 'R', 'N', 'L', '2' };   /// the trailing digit is the format version
+
+void writeNumber(std::ostream& os, std::uint64_t n)    /// variable length encoding: most numbers fit in a byte or two
+{
+    do  {
+        unsigned char c = n & 0x7f;
+        n >>= 7;
+        if(n)
+            c |= 0x80;
+        os.put(c);
+    } while(n);
+}
+
+bool readNumber(std::istream& is, std::uint64_t& n)
+{
+    n = 0;
+    for(unsigned int shift = 0; shift < 64; shift += 7)  {
+        const int c = is.get();
+        if(c == EOF)
+            return false;
+        n |= std::uint64_t(c & 0x7f) << shift;
+        if(!(c & 0x80))
+            return true;
+    }
+    return false;
+}
+
+void writeString(std::ostream& os, const std::string& s)
+{
+    writeNumber(os, s.size());
+    os.write(s.data(), s.size());
+}
+
+std::string withoutTrailingSlash(std::string root)    /// as the walker does: the names built on it match the "P" terms
+{
+    while(root.size() > 1 && root.back() == '/')
+        root.pop_back();
+    return root;
+}
+
+bool readString(std::istream& is, std::string& s)
+{
+    std::uint64_t n;
+    if(!readNumber(is, n) || n > (1u << 20))
+        return false;
+    s.resize(n);
+    return bool(is.read(&s[0], n));
+}
+}
+
+XDGSearch::Journal::Journal(const std::string& r, unsigned long long s) :
+      root(withoutTrailingSlash(r))
+    , rulesSignature(s ^ signature(root))
+{
+}
+
+unsigned long long XDGSearch::Journal::signature(const std::string& s)
+{
+    unsigned long long h = 14695981039346656037ull;
+    for(const unsigned char c : s)  {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+bool XDGSearch::Journal::load(const std::string& fileName)
+{
+    std::ifstream ifs(fileName, std::ios::binary);
+    char magic[sizeof(journalMagic)];
+    std::uint64_t sig, count;
+    if(  !ifs.read(magic, sizeof(magic))
+      || !std::equal(magic, magic + sizeof(magic), journalMagic)
+      || !readNumber(ifs, sig) || sig != rulesSignature       /// rules changed: every directory must be read again
+      || !readNumber(ifs, count) )
+        return false;
+
+    dirs.clear();
+    hashes.clear();
+    for(std::uint64_t i = 0; i != count; ++i)  {
+        std::string path;
+        dirRecord d;
+        std::uint64_t mtime, inode, stamp, files, subdirs;
+        if(  !readString(ifs, path) || !readNumber(ifs, mtime) || !readNumber(ifs, inode)
+          || !readNumber(ifs, stamp) || !readNumber(ifs, files) )   {
+            dirs.clear();
+            return false;
+        }
+        d.mtime = mtime;    d.inode = inode;    d.ignoreStamp = stamp;
+        d.files.resize(files);
+        for(auto& f : d.files)  {
+            std::uint64_t fmtime, fsize, fdevice, finode, fhash;
+            if(  !readString(ifs, f.name) || !readNumber(ifs, fmtime) || !readNumber(ifs, fsize)
+              || !readNumber(ifs, fdevice) || !readNumber(ifs, finode) || !readNumber(ifs, fhash) )  {
+                dirs.clear();
+                hashes.clear();
+                return false;
+            }
+            f.mtime = fmtime;   f.size = fsize;     f.device = fdevice;     f.inode = finode;
+            if(fhash)   /// 0: never extracted
+                hashes.emplace(fileKey(f.device, f.inode, f.size, f.mtime), fhash);
+        }
+        if(!readNumber(ifs, subdirs))   {
+            dirs.clear();
+            hashes.clear();
+            return false;
+        }
+        d.subdirs.resize(subdirs);
+        for(auto& s : d.subdirs)
+            if(!readString(ifs, s)) {
+                dirs.clear();
+                hashes.clear();
+                return false;
+            }
+        dirs.emplace(std::move(path), std::move(d));
+    }
+    return true;
+}
+
+bool XDGSearch::Journal::save(const std::string& fileName) const
+{
+    const std::string tmpName = fileName + ".new";
+    {
+        std::ofstream ofs(tmpName, std::ios::binary | std::ios::trunc);
+        ofs.write(journalMagic, sizeof(journalMagic));
+        writeNumber(ofs, rulesSignature);
+        writeNumber(ofs, dirs.size());
+        for(const auto& d : dirs)   {
+            writeString(ofs, d.first);
+            writeNumber(ofs, d.second.mtime);
+            writeNumber(ofs, d.second.inode);
+            writeNumber(ofs, d.second.ignoreStamp);
+            writeNumber(ofs, d.second.files.size());
+            for(const auto& f : d.second.files) {
+                writeString(ofs, f.name);
+                writeNumber(ofs, f.mtime);
+                writeNumber(ofs, f.size);
+                writeNumber(ofs, f.device);
+                writeNumber(ofs, f.inode);
+                const auto&& h = hashes.find(fileKey(f.device, f.inode, f.size, f.mtime));  /// the hashes of the files gone are dropped
+                writeNumber(ofs, h == hashes.cend() ? 0 : h ->second);
+            }
+            writeNumber(ofs, d.second.subdirs.size());
+            for(const auto& s : d.second.subdirs)
+                writeString(ofs, s);
+        }
+        if(!ofs.flush())
+            return false;
+    }
+    return std::rename(tmpName.c_str(), fileName.c_str()) == 0;
+}
+
+const XDGSearch::Journal::dirRecord* XDGSearch::Journal::find(const std::string& relPath) const
+{
+    const auto&& it = dirs.find(relPath);
+    return it == dirs.cend() ? nullptr : &it ->second;
+}
+
+void XDGSearch::Journal::record(const std::string& relPath, dirRecord&& d)
+{
+    std::lock_guard<std::mutex> lk(m);
+    dirs[relPath] = std::move(d);
+}
+
+std::vector<std::string> XDGSearch::Journal::removedSince(const Journal& newer) const
+{
+    std::vector<std::string> retval;
+    for(const auto& d : dirs)   {
+        const std::string dirName = d.first.empty() ? root : root + "/" + d.first;
+        const auto* const n = newer.find(d.first);
+        std::unordered_set<std::string> kept;
+        if(n)
+            for(const auto& f : n ->files)
+                kept.insert(f.name);
+        for(const auto& f : d.second.files)     /// a directory gone, pruned or with a file gone
+            if(!kept.count(f.name))
+                retval.push_back(dirName + "/" + f.name);
+    }
+    return retval;
+}
+
+bool XDGSearch::Journal::relativeName(const std::string& fileName, std::string& relName) const
+{
+    if(fileName == root)    {
+        relName.clear();
+        return true;
+    }
+    if(fileName.size() <= root.size() + 1 || fileName.compare(0, root.size(), root) != 0 || fileName[root.size()] != '/')
+        return false;
+    relName = fileName.substr(root.size() + 1);
+    return true;
+}
+
+void XDGSearch::Journal::forget(const std::string& relName)
+{
+    std::lock_guard<std::mutex> lk(m);
+    if(relName.empty()) {   /// the pool directory itself
+        dirs.clear();
+        return;
+    }
+    const std::string&& prefix = relName + "/";
+    for(auto d = dirs.begin(); d != dirs.end(); /* null */)
+        if(d ->first == relName || d ->first.compare(0, prefix.size(), prefix) == 0)
+            d = dirs.erase(d);
+        else
+            ++d;
+    /// the directory holding it keeps its mtime: the next scan reads it and sees what else changed
+    const std::size_t&& slash = relName.rfind('/');
+    const auto&& parent = dirs.find(slash == std::string::npos ? std::string() : relName.substr(0, slash));
+    if(parent == dirs.end())
+        return;
+    const std::string&& name = slash == std::string::npos ? relName : relName.substr(slash + 1);
+    auto& files = parent ->second.files;
+    files.erase(std::remove_if(files.begin(), files.end(), [&name] (const fileRecord& f) { return f.name == name; }), files.end());
+}
+
+void XDGSearch::Journal::recordFile(const std::string& relDir, fileRecord&& f)
+{
+    std::lock_guard<std::mutex> lk(m);
+    const auto&& d = dirs.find(relDir);
+    if(d == dirs.end())     /// not walked, or walked by none of the scans since the journal was loaded
+        return;
+    for(auto& old : d ->second.files)
+        if(old.name == f.name)  {
+            old = std::move(f);
+            return;
+        }
+    d ->second.files.push_back(std::move(f));
+}
+
+bool XDGSearch::Journal::findHash(const fileKey& k, std::uint64_t& h)
+{
+    std::lock_guard<std::mutex> lk(m);
+    const auto&& it = hashes.find(k);
+    if(it == hashes.cend())
+        return false;
+    h = it ->second;
+    return true;
+}
+
+void XDGSearch::Journal::recordHash(const fileKey& k, std::uint64_t h)
+{
+    std::lock_guard<std::mutex> lk(m);
+    hashes[k] = h;
+}
+
+void XDGSearch::Journal::inheritHashes(const Journal& previous)
+{
+    std::lock_guard<std::mutex> lk(m);
+    hashes.insert(previous.hashes.cbegin(), previous.hashes.cend());
+}
+
+XDGSearch::Journal::fileKey XDGSearch::Journal::keyOf(const struct stat& st)
+{
+    return fileKey(st.st_dev, st.st_ino, st.st_size, st.st_mtim.tv_sec * 1000000000ll + st.st_mtim.tv_nsec);
+}
+
+void XDGSearch::Journal::graft(const Journal& sub)
+{
+    std::lock_guard<std::mutex> lk(m);
+    for(const auto& d : sub.dirs)
+        dirs[d.first] = d.second;
+}
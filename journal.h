@@ -0,0 +1,85 @@
+/* XDGSearch is a XAPIAN based file indexer and search tool.
+
+    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef XDGSEARCH_INCLUDED_JOURNAL_H
+#define XDGSEARCH_INCLUDED_JOURNAL_H
+
+#include <string>
+#include <vector>
+#include <tuple>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+#include <sys/stat.h>
+
+namespace XDGSearch {
+class Journal;              /// directories and files seen by the last pool scan, it lets rescans skip unchanged sub-trees
+}
+
+/// For each walked directory the journal keeps its mtime and inode, a stamp of its ignore files and the
+/// files and sub-directories the walking rules accepted. A directory whose mtime didn't change can't have
+/// gained or lost entries, so a rescan walks the recorded lists instead of reading the directory.
+/// The hash of the contents of each extracted file is kept too, by device, inode, size and mtime: the files that
+/// didn't change, renamed or moved ones included, aren't read again to be told apart from their copies.
+class XDGSearch::Journal final {
+public:
+    struct fileRecord {
+        std::string name;
+        long long mtime;                    /// nanoseconds since the epoch
+        unsigned long long size;
+        unsigned long long device, inode;
+    };
+    using fileKey = std::tuple<unsigned long long, unsigned long long, unsigned long long, long long>;   /// device, inode, size, mtime
+    struct dirRecord {
+        long long mtime;
+        unsigned long long inode;
+        long long ignoreStamp;              /// mtimes of .gitignore and .xdgsearchignore summed, 0 if there are none
+        std::vector<fileRecord> files;
+        std::vector<std::string> subdirs;
+    };
+    Journal(const std::string&, unsigned long long);    /// pool directory, signature of the walking rules
+    Journal(Journal&&) = delete;
+    Journal& operator=(Journal&&) = delete;
+    ~Journal() = default;
+    bool load(const std::string&);          /// false if the file is missing or it was written for other rules
+    bool save(const std::string&) const;    /// written aside then renamed: a crash never leaves a truncated journal
+    const dirRecord* find(const std::string&) const;    /// record of a pool relative directory, nullptr if not walked
+    void record(const std::string&, dirRecord&&);       /// thread safe
+    std::vector<std::string> removedSince(const Journal&) const;    /// fully qualified names of the files missing into the newer journal
+    bool relativeName(const std::string&, std::string&) const;     /// the pool relative name of a fully qualified one, false if outside
+    void forget(const std::string&);                    /// a pool relative file or directory tree gone or about to be walked again
+    void recordFile(const std::string&, fileRecord&&);  /// a file of a pool relative directory indexed again, if the directory was walked
+    void graft(const Journal&);                         /// the directories another scan of the pool walked, e.g. a sub-tree walked on its own
+    bool findHash(const fileKey&, std::uint64_t&);      /// thread safe, false if the file wasn't hashed as it is
+    void recordHash(const fileKey&, std::uint64_t);     /// thread safe, saved if a walked file has the key
+    void inheritHashes(const Journal&);                 /// the previous scan's ones
+    static fileKey keyOf(const struct stat&);
+    std::size_t size() const                { return dirs.size(); }
+    static unsigned long long signature(const std::string&);    /// FNV-1a hash, stable across runs unlike std::hash
+private:
+    const std::string root;
+    const unsigned long long rulesSignature;
+    struct fileKeyHash {
+        std::size_t operator()(const fileKey& k) const  { return std::hash<unsigned long long>()(std::get<1>(k) * 31 + std::get<3>(k)); }
+    };
+    std::unordered_map<std::string, dirRecord> dirs;
+    std::unordered_map<fileKey, std::uint64_t, fileKeyHash> hashes;
+    std::mutex m;
+};
+
+#endif /// XDGSEARCH_INCLUDED_JOURNAL_H
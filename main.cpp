@@ -21,15 +21,19 @@
 #include <QCommandLineParser>
 #include "wizard.h"
 #include "configuration.h"
+#include "cli.h"
 
 int main(int argc, char *argv[])
 {
+    if(argc > 1 && XDGSearch::isCliCommand(argv[1]))    /// headless subcommands: neither display nor widgets
+        return XDGSearch::runCli(argc, argv);
+
     QApplication app(argc, argv);
     QApplication::setEffectEnabled(Qt::UI_AnimateMenu);
     QApplication::setEffectEnabled(Qt::UI_AnimateCombo);
     QCoreApplication::setOrganizationName("XDGSearch");
     QCoreApplication::setApplicationName("xdgsearch");
-    QCoreApplication::setApplicationVersion(APP_VERSION);   /// the version number is stored into xdgsearch.pro file
+    QCoreApplication::setApplicationVersion(APP_VERSION);   /// the version number is stored into xdgsearch.pri file
     QCommandLineParser parser;
     parser.setApplicationDescription("XDGSearch is a XAPIAN based file indexer and search tool.");
     parser.addHelpOption();
@@ -30,8 +30,7 @@
 #include <memory>
 #include <forward_list>
 #include <QTimer>
-//#include <chrono>
-//#include <iostream>
+#include <QProgressDialog>
 
 namespace Ui {
     class MainWindow;
@@ -51,7 +50,8 @@ MainWindow::MainWindow(QWidget *parent) :
     progressBar.setValue(1);
 
     ui->setupUi(this);  /// prepares the UI
-    ui->menuButton->addAction(ui->actionRebuild_current_Pool);  /// 5 slot for menuButton widget
+    ui->menuButton->addAction(ui->actionRebuild_current_Pool);  /// 6 slot for menuButton widget
+    ui->menuButton->addAction(ui->actionUpdate_current_Pool);
     ui->menuButton->addAction(ui->actionRebuild_All);
     //ui->menuButton->addAction(ui->actionHistory);
     ui->menuButton->addAction(ui->actionPreferences);
@@ -65,14 +65,29 @@ MainWindow::MainWindow(QWidget *parent) :
     ui ->sought->setFocus();
     ui ->statusBar->addPermanentWidget(&this->progressBar, 0);
     ui ->statusBar->showMessage(QString(QObject::trUtf8(" Ready.")), 2000);  /// displays " Ready." timed out by 2 sec
+    if(conf ->watchPools())
+        startWatcher();
 
 }
 
 MainWindow::~MainWindow()
 {
+    watcher.reset();    /// the pending changes are indexed before leaving
     delete ui;
 }
 
+void MainWindow::startWatcher()
+{
+    watcher = std::unique_ptr<XDGSearch::Watcher>(new XDGSearch::Watcher(XDGSearch::updateDB, 2, conf ->rescanInterval()));
+    for(auto p = XDGSearch::Pool::DESKTOP; p != XDGSearch::Pool::END; ++p)   {
+        const XDGSearch::Configuration c(p);
+        const auto pt = c.enqueryPool();
+        if(!std::get<XDGSearch::LOCALPOOLNAME>(pt).empty() && !std::get<XDGSearch::POOLDIRPATH>(pt).empty())
+            watcher ->addPool(p, std::get<XDGSearch::POOLDIRPATH>(pt), c.enqueryWalker());
+    }
+    watcher ->start();
+}
+
 void MainWindow::readMainWindowSizeAndPosition()
 {
     const QByteArray geometry = conf ->readMainWindowGeometry();
@@ -168,18 +183,60 @@ void MainWindow::on_actionRebuild_current_Pool_triggered()
     XDGSearch::Indexer idx(this, ui ->poolCBox->currentData().value<XDGSearch::Pool>());  /// build indexer by passing the pool value pointed from poolCBox
 
     QObject::connect(&idx, &XDGSearch::Indexer::progressValue, &this->progressBar, &QProgressBar::setValue);
-    //auto t1 = std::chrono::high_resolution_clock::now();
-    if(idx.populateDB())    /// rebuild and overwrite the database
+    if(buildDB(idx, false))     /// rebuild and overwrite the database
         ui ->statusBar->showMessage(QString(QObject::trUtf8(" Done!")), 2000);  /// displays " Done!" timed out by 2 seconds
     else
         ui ->statusBar->showMessage(QString(QObject::trUtf8(" Interrupted!")), 2000);  /// displays " Interrupted!" timed out by 2 seconds
-    /*auto t2 = std::chrono::high_resolution_clock::now();
-    auto int_ms = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1);
-    std::cout << "populateDB millisec : " << int_ms.count() << std::endl;
-*/
     QTimer::singleShot(2000, &this->progressBar, SLOT(hide()));  /// hide progressBar timed out by 2 seconds
 }
 
+void MainWindow::on_actionUpdate_current_Pool_triggered()
+{   /// index only what changed since the last build of the database pointed by poolCBox combobox
+    progressBar.setVisible(true);
+    const QString statusBarMessage = QString(QObject::trUtf8(" Updating: "))
+                                   + ui ->poolCBox->currentText()
+                                   + QString(QObject::trUtf8(" pool ..."));
+
+    ui ->statusBar->showMessage(statusBarMessage);
+    XDGSearch::Indexer idx(this, ui ->poolCBox->currentData().value<XDGSearch::Pool>());
+
+    QObject::connect(&idx, &XDGSearch::Indexer::progressValue, &this->progressBar, &QProgressBar::setValue);
+    if(buildDB(idx, true))      /// update the database, it falls back to a rebuild when there is no journal of the last one
+        ui ->statusBar->showMessage(QString(QObject::trUtf8(" Done!")), 2000);
+    else
+        ui ->statusBar->showMessage(QString(QObject::trUtf8(" Interrupted!")), 2000);
+    QTimer::singleShot(2000, &this->progressBar, SLOT(hide()));
+}
+
+bool MainWindow::buildDB(const XDGSearch::Indexer& idx, bool incremental)
+{   /// runs the indexer showing its progress into a modal dialog window
+    QProgressDialog progressDialog(this);       /// create a progress dialog window
+    /// progress dialog window setting stuff:
+    progressDialog.setWindowModality(Qt::WindowModal);
+    progressDialog.setCancelButtonText(QObject::trUtf8("&Cancel"));
+    progressDialog.setRange(0, 0);              /// busy indicator until the walker finds the first files
+    progressDialog.setWindowTitle(QObject::trUtf8("Indexing %1 files").arg(ui ->poolCBox->currentText()));
+    progressDialog.setMinimumDuration(0);
+    /// setting ends
+    QObject::connect(&idx, &XDGSearch::Indexer::progress, [&] (unsigned int n, unsigned int nof, bool crawling) {
+        progressDialog.setMaximum(nof);
+        progressDialog.setValue(n);     /// it lets the dialog window process the events, the Cancel button among them
+        progressDialog.setLabelText(crawling
+                                    ? QObject::trUtf8("Indexing file number %1 of %n found so far...", 0, nof).arg(n)
+                                    : QObject::trUtf8("Indexing file number %1 of %n...", 0, nof).arg(n));
+        progressDialog.resize(300,100);     /// it resizes the dialog window to x:300, y:100 pixel
+        if(progressDialog.wasCanceled())    /// if the Cancel button of the progress dialog window is cliked then stop
+            idx.cancel();
+    });
+    idx.setInteractive(true);   /// the user waits for it, besides it runs on the GUI thread which must not be slowed down
+    const bool&& retval = idx.populateDB(incremental);
+    if(!idx.isPriorityApplied())
+        QMessageBox::warning( this, QObject::trUtf8("Indexing priority")
+                            , QObject::trUtf8("The system refused the normal priority, the pool was indexed with a lower one: "
+                                              "raising it back needs RLIMIT_NICE or CAP_SYS_NICE.") );
+    return retval;
+}
+
 void MainWindow::on_actionRebuild_All_triggered()
 {   /// rebuild and overwrite all the databases
     progressBar.setVisible(true);
@@ -213,6 +270,16 @@ void XDGSearch::rebuildDB(const XDGSearch::Pool& p)
         ;
 }
 
+bool XDGSearch::updateDB(const XDGSearch::Pool& p, const std::vector<std::string>& changed, bool rescan)
+{
+    const XDGSearch::Configuration c(p);
+    if(!c.isPopulatedDB(p))     /// it's up to the user to build it the first time
+        return true;
+
+    XDGSearch::Indexer idx(nullptr, p);
+    return rescan ? idx.populateDB(true) : idx.updateFiles(changed);
+}
+
 void MainWindow::on_actionPreferences_triggered()
 {   /// displays preference dialog
     QDialog* const d = new Preferences(this);
@@ -242,7 +309,7 @@ void MainWindow::on_sought_returnPressed()
     else    {
         if(maybeBuildDB())  {   /// asks the user whether wanna build the database
             ui ->statusBar->showMessage(statusBarMessage);
-            idx.populateDB();
+            buildDB(idx, false);
             ui ->statusBar->showMessage(QString(QObject::trUtf8(" Done!")), 2000);
             idx.seek(soughtTerms);
         } else  {       /// informs the user that rebuild database is necessary
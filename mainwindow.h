@@ -21,6 +21,7 @@
 
 #include "indexer.h"    /// first because required by Xapian
 #include "ui_mainwindow.h"
+#include "watcher.h"
 #include <QMainWindow>
 #include <QProgressBar>
 #include <memory>
@@ -34,6 +35,7 @@ namespace Ui {
 namespace XDGSearch {
     class Configuration;    /// declaration for further use in the MainWindow class
     void rebuildDB(const XDGSearch::Pool&);  /// threaded function to build pool's databases
+    bool updateDB(const XDGSearch::Pool&, const std::vector<std::string>&, bool);   /// watcher's callback, see watcher.h
 }
 
 class MainWindow final : public QMainWindow
@@ -46,8 +48,9 @@ public:
     MainWindow& operator=(MainWindow&&) = delete;
     ~MainWindow();
 private slots:
-    void on_actionHistory_triggered();      /// 5 slot invoked by each popup menu item
+    void on_actionHistory_triggered();      /// 6 slot invoked by each popup menu item
     void on_actionRebuild_current_Pool_triggered();
+    void on_actionUpdate_current_Pool_triggered();
     void on_actionRebuild_All_triggered();
     void on_actionPreferences_triggered();
     void on_actionAbout_triggered();
@@ -62,6 +65,9 @@ private:
     Ui::MainWindow* const ui;
     QProgressBar progressBar;   /// progress bar to show database builds progress that it grows helper by helper
     std::unique_ptr<XDGSearch::Configuration> const conf; /// useful to perform query/set operations to the .conf file
+    std::unique_ptr<XDGSearch::Watcher> watcher;    /// keeps the databases up to date when "watchPools" is set
+    void startWatcher();
+    bool buildDB(const XDGSearch::Indexer&, bool);  /// populate the database through a progress dialog window, true if not canceled
     void readMainWindowSizeAndPosition();        /// set the MainWindow position and geometry reading the .conf file
     void populateCBox() const;        /// set the combobox adding local pools name
     bool maybeQuit();           /// ask confirmation for quitting
@@ -0,0 +1,267 @@
+/* XDGSearch is a XAPIAN based file indexer and search tool.
+
+    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "markup.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define XDGSEARCH_X86_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace {
+const std::size_t maxNeedles = 8;       /// bytes a vectorized scan looks for at once
+
+/// offset of the first byte of p equal to one of the needles, n if none
+using findAnyType = std::size_t (*)(const char*, std::size_t, const char*, std::size_t);
+
+std::size_t findAnyScalar(const char* p, std::size_t n, const char* needles, std::size_t k)
+{
+    for(std::size_t i = 0; i != n; ++i)
+        for(std::size_t j = 0; j != k; ++j)
+            if(p[i] == needles[j])
+                return i;
+    return n;
+}
+
+#ifdef XDGSEARCH_X86_DISPATCH
+__attribute__((target("sse2")))
+std::size_t findAnySSE2(const char* p, std::size_t n, const char* needles, std::size_t k)
+{
+    __m128i v[maxNeedles];
+    for(std::size_t j = 0; j != k; ++j)
+        v[j] = _mm_set1_epi8(needles[j]);
+    std::size_t i = 0;
+    for(/* null */; i + 16 <= n; i += 16)   {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        __m128i hits = _mm_cmpeq_epi8(block, v[0]);
+        for(std::size_t j = 1; j != k; ++j)
+            hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, v[j]));
+        if(const unsigned int mask = _mm_movemask_epi8(hits))
+            return i + __builtin_ctz(mask);
+    }
+    return i + findAnyScalar(p + i, n - i, needles, k);
+}
+
+__attribute__((target("avx2")))
+std::size_t findAnyAVX2(const char* p, std::size_t n, const char* needles, std::size_t k)
+{
+    __m256i v[maxNeedles];
+    for(std::size_t j = 0; j != k; ++j)
+        v[j] = _mm256_set1_epi8(needles[j]);
+    std::size_t i = 0;
+    for(/* null */; i + 32 <= n; i += 32)   {
+        const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        __m256i hits = _mm256_cmpeq_epi8(block, v[0]);
+        for(std::size_t j = 1; j != k; ++j)
+            hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(block, v[j]));
+        if(const unsigned int mask = _mm256_movemask_epi8(hits))
+            return i + __builtin_ctz(mask);
+    }
+    return i + findAnySSE2(p + i, n - i, needles, k);   /// the tail, less than 32 bytes
+}
+#endif
+
+struct dispatchType {
+    findAnyType findAny;
+    const char* name;
+};
+
+dispatchType selectFindAny()
+{
+#ifdef XDGSEARCH_X86_DISPATCH
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2"))
+        return { findAnyAVX2, "avx2" };
+    if(__builtin_cpu_supports("sse2"))
+        return { findAnySSE2, "sse2" };
+#endif
+    return { findAnyScalar, "scalar" };
+}
+
+const dispatchType& dispatch()      /// chosen once, on first use
+{
+    static const dispatchType d = selectFindAny();
+    return d;
+}
+
+inline char toLowerASCII(char c)
+{
+    return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+}
+
+/// the lower case of a letter of two bytes, from U+0080 to U+07FF, whose lower case has two bytes too
+unsigned int toLowerTwoBytes(unsigned int c)
+{
+    if((c >= 0xC0 && c <= 0xDE && c != 0xD7) || (c >= 0x391 && c <= 0x3AB && c != 0x3A2) || (c >= 0x410 && c <= 0x42F))
+        return c + 0x20;    /// Latin-1 but the multiplication sign, Greek, Cyrillic
+    if((c >= 0x100 && c <= 0x137 && c != 0x130) || (c >= 0x14A && c <= 0x177))
+        return c | 1;       /// Latin Extended-A, upper case even: dotted I has a one byte lower case
+    if((c >= 0x139 && c <= 0x148) || (c >= 0x179 && c <= 0x17E))
+        return c & 1 ? c + 1 : c;     /// Latin Extended-A, upper case odd
+    if(c >= 0x400 && c <= 0x40F)
+        return c + 0x50;
+    switch(c)   {
+        case 0x178 : return 0xFF;       /// Y with diaeresis
+        case 0x386 : return 0x3AC;      /// Greek with tonos
+        case 0x388 : case 0x389 : case 0x38A : return c + 0x25;
+        case 0x38C : return 0x3CC;
+        case 0x38E : case 0x38F : return c + 0x3F;
+        case 0x3C2 : return 0x3C3;      /// final sigma
+        default    : return c;
+    }
+}
+
+inline bool isTwoBytes(const char* p, std::size_t n)    /// a lead byte of two and its continuation
+{
+    return n >= 2 && (static_cast<unsigned char>(p[0]) & 0xE0) == 0xC0 && (static_cast<unsigned char>(p[1]) & 0xC0) == 0x80;
+}
+
+inline unsigned int decodeTwoBytes(const char* p)
+{
+    return (static_cast<unsigned char>(p[0]) & 0x1F) << 6 | (static_cast<unsigned char>(p[1]) & 0x3F);
+}
+
+inline void encodeTwoBytes(unsigned int c, char* p)
+{
+    p[0] = static_cast<char>(0xC0 | c >> 6);
+    p[1] = static_cast<char>(0x80 | (c & 0x3F));
+}
+
+std::string toLower(std::string s)
+{
+    for(std::size_t i = 0; i < s.size(); ++i)
+        if(isTwoBytes(&s[i], s.size() - i)) {
+            encodeTwoBytes(toLowerTwoBytes(decodeTwoBytes(&s[i])), &s[i]);
+            ++i;
+        } else
+            s[i] = toLowerASCII(s[i]);
+    return s;
+}
+
+/// t, in lower case, matches the text at p, which holds t.size() bytes at least
+bool matches(const std::string& t, const char* p)
+{
+    for(std::size_t i = 0; i < t.size(); ++i)
+        if(isTwoBytes(&t[i], t.size() - i)) {
+            if(!isTwoBytes(p + i, 2))
+                return false;
+            char lower[2];
+            encodeTwoBytes(toLowerTwoBytes(decodeTwoBytes(p + i)), lower);
+            if(lower[0] != t[i] || lower[1] != t[i + 1])
+                return false;
+            ++i;
+        } else if(t[i] != toLowerASCII(p[i]))
+            return false;
+    return true;
+}
+}
+
+const char* XDGSearch::vectorExtension()
+{
+    return dispatch().name;
+}
+
+void XDGSearch::escapeHtml(const char* p, std::size_t n, std::string& out)
+{
+    const findAnyType findAny = dispatch().findAny;
+    out.reserve(out.size() + n + n / 16);
+    for(std::size_t i = 0; i < n; ++i)  {
+        const std::size_t&& run = findAny(p + i, n - i, "&<>", 3);
+        out.append(p + i, run);     /// the bytes before the reserved character at once
+        i += run;
+        if(i == n)
+            break;
+        switch(p[i])    {
+            case '&' : out += "&amp;"; break;
+            case '<' : out += "&lt;";  break;
+            default  : out += "&gt;";
+        }
+    }
+}
+
+std::string XDGSearch::escapeHtml(const std::string& s)
+{
+    std::string retval;
+    escapeHtml(s.data(), s.size(), retval);
+    return retval;
+}
+
+XDGSearch::TermScanner::TermScanner(const std::vector<std::string>& sought) :
+    isFirst()
+{
+    for(const auto& t : sought)
+        if(!t.empty())
+            terms.push_back(toLower(t));
+    std::stable_sort( terms.begin(), terms.end()
+                    , [] (const std::string& a, const std::string& b) { return a.size() > b.size(); });
+    const auto addFirst = [this] (char c)   {
+        if(!isFirst[static_cast<unsigned char>(c)]) {
+            isFirst[static_cast<unsigned char>(c)] = true;
+            firsts += c;
+        }
+    };
+    for(const auto& t : terms)
+        if(isTwoBytes(t.data(), t.size()))  {   /// the lead bytes of the letters whose lower case it is
+            const unsigned int&& lower = decodeTwoBytes(t.data());
+            for(unsigned int c = 0x80; c != 0x800; ++c)
+                if(toLowerTwoBytes(c) == lower)
+                    addFirst(static_cast<char>(0xC0 | c >> 6));
+        } else  {
+            addFirst(t[0]);
+            if(t[0] >= 'a' && t[0] <= 'z')
+                addFirst(t[0] - ('a' - 'A'));
+        }
+}
+
+std::size_t XDGSearch::TermScanner::find(const char* p, std::size_t n, std::size_t from, std::size_t& length) const
+{
+    if(terms.empty())
+        return std::string::npos;
+    const findAnyType findAny = dispatch().findAny;
+    for(/* null */; from < n; ++from)   {
+        if(firsts.size() <= maxNeedles)     /// the next candidate: a byte that starts a term
+            from += findAny(p + from, n - from, firsts.data(), firsts.size());
+        else
+            while(from < n && !isFirst[static_cast<unsigned char>(p[from])])
+                ++from;
+        if(from >= n)
+            break;
+        for(const auto& t : terms)
+            if(t.size() <= n - from && matches(t, p + from))  {
+                length = t.size();
+                return from;
+            }
+    }
+    return std::string::npos;
+}
+
+std::string XDGSearch::highlightTerms( const std::string& text, const TermScanner& scanner
+                                     , const std::string& open, const std::string& close )
+{
+    std::string retval;
+    retval.reserve(text.size() + text.size() / 8);
+    std::size_t pos = 0;
+    for(std::size_t length, match; (match = scanner.find(text.data(), text.size(), pos, length)) != std::string::npos; /* null */)  {
+        retval.append(text, pos, match - pos).append(open).append(text, match, length).append(close);
+        pos = match + length;
+    }
+    retval.append(text, pos, std::string::npos);
+    return retval;
+}
@@ -0,0 +1,55 @@
+/* XDGSearch is a XAPIAN based file indexer and search tool.
+
+    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef XDGSEARCH_INCLUDED_MARKUP_H
+#define XDGSEARCH_INCLUDED_MARKUP_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace XDGSearch {
+class TermScanner;          /// finds the sought terms in a text regardless of the case
+void escapeHtml(const char*, std::size_t, std::string&);    /// appends the text with &, < and > replaced by entities
+std::string escapeHtml(const std::string&);
+std::string highlightTerms( const std::string&      /// text, already escaped
+                          , const TermScanner&
+                          , const std::string&      /// markup opening each match
+                          , const std::string& );   /// markup closing each match
+const char* vectorExtension();      /// the instruction set the scans run with: "avx2", "sse2" or "scalar"
+}
+
+/// Texts are UTF-8 bytes: the ASCII letters and the two byte Latin, Greek and Cyrillic letters are matched regardless
+/// of their case, their two cases have the same length; the other characters must match exactly. A match starts and
+/// ends on the bounds of characters, as a lead byte is never a continuation byte. The candidates are found by
+/// comparing the first bytes of the terms, in each case, with 16 or 32 bytes of the text at once, the instruction
+/// set is chosen at run time.
+class XDGSearch::TermScanner final {
+public:
+    explicit TermScanner(const std::vector<std::string>&);  /// the sought strings, empty ones are ignored
+    std::size_t find( const char*, std::size_t      /// text and its size
+                    , std::size_t                   /// offset the search starts from
+                    , std::size_t& ) const;         /// length of the match, the longest one where more terms match
+                                                    /// return the offset of the match, std::string::npos if none
+private:
+    std::vector<std::string> terms;     /// lower case, the longest first
+    std::string firsts;                 /// the first bytes of the terms, in every case
+    bool isFirst[256];
+};
+
+#endif /// XDGSEARCH_INCLUDED_MARKUP_H
@@ -20,10 +20,16 @@
 #include "preferences.h"
 #include "ui_preferences.h"
 #include "helpers.h"
+#include "stats.h"
 #include <sstream>
+#include <iomanip>
 #include <QDirIterator>
 #include <QFileDialog>
 #include <QMessageBox>
+#include <QFile>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
 
 
 Preferences::Preferences(QWidget *parent) :
@@ -156,6 +162,23 @@ void Preferences::on_removeHelper_clicked()
     buttonOk->setEnabled(false);    buttonApply->setEnabled(true);   changesAlreadyApplied = false; currentTabNumber =0;
 }
 
+void Preferences::warnOverlappingPools()
+{   /// files of nested pools are crawled and indexed by both pools, the text cache spares extracting them twice
+    std::string nested;
+    for(const auto& o : conf ->overlappingPools())
+        nested += o.first + " is inside " + o.second + "\n";
+    if(nested.empty())
+        return;
+    QMessageBox* mb = new QMessageBox(  QMessageBox::Warning
+                                      , QCoreApplication::applicationName()
+                                      , QObject::trUtf8("These pool directories overlap, their common files are indexed by each pool:\n\n")
+                                        + QString::fromStdString(nested)
+                                      , QMessageBox::StandardButton::Ok
+                                      , this);
+    mb->exec();
+    delete mb;
+}
+
 void Preferences::clicked_buttonBoxCancel()
 {
     this->close();
@@ -170,6 +193,7 @@ void Preferences::clicked_buttonBoxOk()
             const XDGSearch::Configuration conf(ui->poolCBox->currentData().value<XDGSearch::Pool>());    /// builds Configuration object using the current pool's poolCBox item
             const auto pt = collectWidgetValue(conf);     /// retrieves this window's fields value in order to save them into the .conf file
             conf.writeSettings(pt);
+            warnOverlappingPools();
         }
         this->close();
     }
@@ -186,6 +210,7 @@ void Preferences::clicked_buttonBoxApply()
         const XDGSearch::Configuration conf(ui->poolCBox->currentData().value<XDGSearch::Pool>());    /// builds Configuration object using the current pool's poolCBox item
         const auto pt = collectWidgetValue(conf); /// retrieves this window's fields value in order to save them into the .conf file
         conf.writeSettings(pt);
+        warnOverlappingPools();
         changesAlreadyApplied = true;
     }
     if(ui->tabWidget->currentIndex() ==1)
@@ -318,6 +343,76 @@ void Preferences::on_tabWidget_currentChanged(int index)
         }
         delete msgBox;
     }
+    if(ui->tabWidget->currentIndex() == 2)  /// the Statistics page, built afresh each time it's shown
+        refreshStatistics();
+}
+
+void Preferences::refreshStatistics() const
+{   /// the figures are written by each build beside its database, see stats.h
+    std::ostringstream oss;
+    oss << std::fixed;
+    for(auto p = XDGSearch::Pool::DESKTOP; p != XDGSearch::Pool::END; ++p)  {
+        const XDGSearch::Configuration c(p);
+        const std::string&& dbName = std::get<XDGSearch::LOCALPOOLNAME>(c.enqueryPool());
+        QFile f(QString::fromStdString(dbName + ".stats.json"));
+        if(dbName.empty() || !f.open(QIODevice::ReadOnly))  /// not configured or never built
+            continue;
+        const QJsonObject&& o = QJsonDocument::fromJson(f.readAll()).object();
+        oss << dbName << ": " << std::setprecision(0) << o["files"].toDouble() << " files in "
+            << std::setprecision(1) << o["seconds"].toDouble() << " s, "
+            << (o["incremental"].toDouble() ? "updated " : "built ")
+            << QDateTime::fromMSecsSinceEpoch(qint64(o["finished"].toDouble()) * 1000).toString(Qt::ISODate).toStdString()
+            << ", peak resident memory " << std::setprecision(0) << o["peakRSS"].toDouble() / (1024 * 1024) << " MiB\n";
+        if(o.contains("databaseBytes"))
+            oss << "  database " << std::setprecision(1) << o["databaseBytes"].toDouble() / (1024 * 1024) << " MiB, "
+                << (o["positions"].toDouble() ? "with" : "without") << " positions\n";
+        if(const double&& paragraphs = o["paragraphs"].toDouble())  {
+            oss << "  " << std::setprecision(0) << paragraphs << " paragraphs stored";
+            if(o.contains("paragraphAllocations"))  /// counted by the builds made with CONFIG+=countallocations only
+                oss << ", " << std::setprecision(1) << o["paragraphAllocations"].toDouble() / paragraphs << " heap allocations each";
+            oss << "\n";
+        }
+        if(const double&& text = o["paragraphTextBytes"].toDouble())
+            oss << "  " << std::setprecision(1) << text / (1024 * 1024) << " MiB of text stored in "
+                << o["paragraphDataBytes"].toDouble() / (1024 * 1024) << " MiB, "
+                << std::setprecision(1) << o["paragraphDecodeNanoseconds"].toDouble() / 1000 << " us to read a paragraph back\n";
+        if(const double&& failures = o["paragraphEncodeFailures"].toDouble())
+            oss << "  " << std::setprecision(0) << failures << " paragraphs stored uncompressed, zlib couldn't read them back\n";
+        if(const double&& stems = o["stemCacheHits"].toDouble() + o["stemCacheMisses"].toDouble())
+            oss << "  " << std::setprecision(1) << 100. * o["stemCacheHits"].toDouble() / stems << "% of the words stemmed from the cache, "
+                << std::setprecision(3) << o["stemSavedNanoseconds"].toDouble() / 1e9 << " s saved\n";
+
+        oss << "  " << std::left << std::setw(14) << "stage" << std::right << std::setw(10) << "total s"
+            << std::setw(10) << "count" << std::setw(10) << "mean ms" << '\n';
+        const QJsonObject&& stages = o["stages"].toObject();
+        for(int s = 0; s != XDGSearch::BuildStats::STAGES; ++s)  {
+            const char* const name = XDGSearch::BuildStats::stageName(static_cast<XDGSearch::BuildStats::Stage>(s));
+            const QJsonObject&& h = stages[name].toObject();
+            const double&& count = h["count"].toDouble();
+            const double&& total = h["total"].toDouble() / 1e9;
+            oss << "  " << std::left << std::setw(14) << name << std::right
+                << std::setprecision(3) << std::setw(10) << total
+                << std::setprecision(0) << std::setw(10) << count
+                << std::setprecision(2) << std::setw(10) << (count ? total * 1000 / count : 0.) << '\n';
+        }
+
+        for(const char* group : { "helpers", "extensions" })    {
+            oss << "  " << std::left << std::setw(14) << (std::string(group) == "helpers" ? "helper" : "extension") << std::right
+                << std::setw(10) << "files" << std::setw(10) << "mean ms" << std::setw(10) << "MiB" << '\n';
+            const QJsonObject&& g = o[group].toObject();
+            for(auto i = g.constBegin(); i != g.constEnd(); ++i)    {
+                const QJsonObject&& latency = i.value().toObject()["latency"].toObject();
+                const double&& count = latency["count"].toDouble();
+                oss << "  " << std::left << std::setw(14) << (i.key().isEmpty() ? std::string("(none)") : i.key().toStdString()) << std::right
+                    << std::setprecision(0) << std::setw(10) << count
+                    << std::setprecision(2) << std::setw(10) << (count ? latency["total"].toDouble() / 1e6 / count : 0.)
+                    << std::setw(10) << i.value().toObject()["bytes"].toObject()["total"].toDouble() / (1024 * 1024) << '\n';
+            }
+        }
+        oss << '\n';
+    }
+    const std::string&& text = oss.str();
+    ui->statisticsText->setPlainText(text.empty() ? QObject::trUtf8("No pool was built yet.") : QString::fromStdString(text));
 }
 
 void Preferences::on_helperName_editingFinished()
@@ -79,6 +79,8 @@ private:
 
     void toggleWidgetOnEditing();
     void refreshallHelpersList() const;
+    void warnOverlappingPools();          /// tell the user which pool directories are nested into another pool's one
+    void refreshStatistics() const;       /// read the statistics of the last build of each pool
 };
 
 #endif /// XDGSEARCH_INCLUDED_PREFERENCES_H
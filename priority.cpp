@@ -0,0 +1,74 @@
+/* XDGSearch is a XAPIAN based file indexer and search tool.
+
+    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "priority.h"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+
+namespace {
+/// from linux/ioprio.h, glibc has no wrapper for ioprio_set()
+const int ioprioWhoProcess = 1;     /// with a thread id it selects the thread
+const int ioprioClassShift = 13;
+enum { IOPRIO_NONE, IOPRIO_RT, IOPRIO_BE, IOPRIO_IDLE };
+}
+
+const XDGSearch::priorityType XDGSearch::interactivePriority()
+{
+    return XDGSearch::priorityType("normal", 0, "normal");
+}
+
+bool XDGSearch::applyPriority(const XDGSearch::priorityType& p)
+{
+    const pid_t&& tid = ::syscall(SYS_gettid);
+    const std::string& policyName = std::get<CPUPOLICY>(p);
+    const std::string& ioName = std::get<IOCLASS>(p);
+    bool retval = true;
+
+    int policy = SCHED_OTHER;
+    if(policyName == "batch")           /// CPU bound, the scheduler gives it longer and rarer slices
+        policy = SCHED_BATCH;
+    else if(policyName == "idle")       /// it runs only when nothing else wants the CPU
+        policy = SCHED_IDLE;
+    sched_param sp;
+    sp.sched_priority = 0;
+    if(::sched_setscheduler(0, policy, &sp) != 0)   {   /// 0: the calling thread
+        std::clog << "cpu policy " << policyName << ": " << std::strerror(errno) << std::endl;
+        retval = false;
+    }
+
+    if(::setpriority(PRIO_PROCESS, tid, std::get<NICELEVEL>(p)) != 0)   {   /// raising it back needs RLIMIT_NICE or CAP_SYS_NICE
+        std::clog << "nice level " << std::get<NICELEVEL>(p) << ": " << std::strerror(errno) << std::endl;
+        retval = false;
+    }
+
+    int ioprio = IOPRIO_NONE << ioprioClassShift;   /// "normal": the I/O priority follows the nice level
+    if(ioName == "idle")                /// the disk serves it only when no one else uses it
+        ioprio = IOPRIO_IDLE << ioprioClassShift;
+    else if(ioName == "besteffort")     /// the lowest level of the default class
+        ioprio = IOPRIO_BE << ioprioClassShift | 7;
+    if(::syscall(SYS_ioprio_set, ioprioWhoProcess, tid, ioprio) != 0)   {
+        std::clog << "io class " << ioName << ": " << std::strerror(errno) << std::endl;
+        retval = false;
+    }
+    return retval;
+}
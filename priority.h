@@ -0,0 +1,32 @@
+/* XDGSearch is a XAPIAN based file indexer and search tool.
+
+    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef XDGSEARCH_INCLUDED_PRIORITY_H
+#define XDGSEARCH_INCLUDED_PRIORITY_H
+
+#include "configuration.h"
+
+namespace XDGSearch {
+/// On Linux the scheduling policy, the nice value and the I/O priority belong to each thread and they are
+/// inherited by the threads and processes it creates: set on the thread running a build, they reach the
+/// walker threads, the extraction threads and the helpers those start.
+bool applyPriority(const priorityType&);    /// to the calling thread, false if the kernel refused some of it
+const priorityType interactivePriority();   /// normal scheduling: the user is waiting for the build
+}
+
+#endif /// XDGSEARCH_INCLUDED_PRIORITY_H
@@ -0,0 +1,207 @@
+/* XDGSearch is a XAPIAN based file indexer and search tool.
+
+    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "stats.h"
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cctype>
+#include <cstdlib>
+#include <new>
+
+#ifdef XDGSEARCH_COUNT_ALLOCATIONS
+/// The global operator new is replaced to count the allocations, each thread on its own counter: the indexing
+/// tells how many allocations each stored paragraph costs, which is what reusing the buffers is about. It's a
+/// benchmark build only, the application and the library keep the allocator they are linked with
+namespace {
+thread_local unsigned long long threadAllocations = 0;
+}
+
+void* operator new(std::size_t size)
+{
+    ++threadAllocations;
+    for(;;) {
+        if(void* p = std::malloc(size ? size : 1))
+            return p;
+        const std::new_handler handler = std::get_new_handler();
+        if(!handler)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+unsigned long long XDGSearch::BuildStats::allocations()
+{
+    return threadAllocations;
+}
+#else
+unsigned long long XDGSearch::BuildStats::allocations()
+{
+    return 0;
+}
+#endif
+
+std::string XDGSearch::jsonString(const std::string& s)
+{
+    std::string retval = "\"";
+    for(const char& c : s)
+        switch(c)   {
+        case '"'  : retval += "\\\""; break;
+        case '\\' : retval += "\\\\"; break;
+        case '\n' : retval += "\\n";  break;
+        case '\r' : retval += "\\r";  break;
+        case '\t' : retval += "\\t";  break;
+        default :
+            if(static_cast<unsigned char>(c) < 0x20)   {   /// the other control characters
+                char u[7];
+                std::snprintf(u, sizeof u, "\\u%04x", c);
+                retval += u;
+            } else
+                retval += c;    /// helpers' output is expected UTF-8 encoded
+        }
+    return retval + "\"";
+}
+
+XDGSearch::BuildStats::Histogram::Histogram() :
+      buckets()
+    , count(0)
+    , total(0)
+    , max(0)
+{
+}
+
+void XDGSearch::BuildStats::Histogram::add(unsigned long long v)
+{
+    ++buckets[v ? 63 - __builtin_clzll(v) : 0];
+    ++count;
+    total += v;
+    if(v > max)
+        max = v;
+}
+
+std::string XDGSearch::BuildStats::Histogram::toJson() const
+{
+    std::ostringstream oss;
+    oss << "{\"count\":" << count << ",\"total\":" << total << ",\"max\":" << max << ",\"buckets\":[";
+    bool first = true;
+    for(unsigned int i = 0; i != 64; ++i)
+        if(buckets[i])  {   /// [lower bound, count], the empty ones are left out
+            oss << (first ? "" : ",") << "[" << (i ? 1ull << i : 0) << "," << buckets[i] << "]";
+            first = false;
+        }
+    oss << "]}";
+    return oss.str();
+}
+
+XDGSearch::BuildStats::BuildStats() :
+      stages(STAGES)
+    , start(std::chrono::steady_clock::now())
+{
+}
+
+const char* XDGSearch::BuildStats::stageName(Stage s)
+{
+    static const char* const names[STAGES] = { "walk", "spawn", "helperRun", "pipeRead", "split"
+                                             , "indexText", "addDocument", "commit", "compact" };
+    return names[s];
+}
+
+void XDGSearch::BuildStats::add(Stage s, unsigned long long ns)
+{
+    std::lock_guard<std::mutex> lk(m);
+    stages[s].add(ns);
+}
+
+void XDGSearch::BuildStats::addFile( const std::string& helper
+                                   , const std::string& fileName
+                                   , unsigned long long ns
+                                   , unsigned long long bytes )
+{
+    const auto&& slash = fileName.rfind('/');
+    const auto&& dot = fileName.rfind('.');
+    std::string ext;
+    if(dot != std::string::npos && (slash == std::string::npos || dot > slash))
+        for(auto c = fileName.cbegin() + dot + 1; c != fileName.cend(); ++c)
+            ext += std::tolower(static_cast<unsigned char>(*c));
+
+    std::lock_guard<std::mutex> lk(m);
+    auto& h = helpers[helper];
+    h.first.add(ns);
+    h.second.add(bytes);
+    auto& e = extensions[ext];
+    e.first.add(ns);
+    e.second.add(bytes);
+}
+
+void XDGSearch::BuildStats::setCounter(const std::string& name, unsigned long long value)
+{
+    std::lock_guard<std::mutex> lk(m);
+    for(auto& c : counters)
+        if(c.first == name) {
+            c.second = value;
+            return;
+        }
+    counters.emplace_back(name, value);
+}
+
+void XDGSearch::BuildStats::addCounter(const std::string& name, unsigned long long value)
+{
+    std::lock_guard<std::mutex> lk(m);
+    for(auto& c : counters)
+        if(c.first == name) {
+            c.second += value;
+            return;
+        }
+    counters.emplace_back(name, value);
+}
+
+bool XDGSearch::BuildStats::save(const std::string& fileName) const
+{
+    std::ostringstream oss;
+    {
+        std::lock_guard<std::mutex> lk(m);
+        oss << "{\"seconds\":" << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()
+            << ",\"finished\":" << std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        for(const auto& c : counters)
+            oss << "," << jsonString(c.first) << ":" << c.second;
+        oss << ",\"stages\":{";     /// nanoseconds
+        for(int s = 0; s != STAGES; ++s)
+            oss << (s ? "," : "") << jsonString(stageName(static_cast<Stage>(s))) << ":" << stages[s].toJson();
+        for(const auto& group : { std::make_pair("helpers", &helpers), std::make_pair("extensions", &extensions) })  {
+            oss << "},\"" << group.first << "\":{";
+            bool first = true;
+            for(const auto& h : *group.second)  {
+                oss << (first ? "" : ",") << jsonString(h.first)
+                    << ":{\"latency\":" << h.second.first.toJson() << ",\"bytes\":" << h.second.second.toJson() << "}";
+                first = false;
+            }
+        }
+        oss << "}}\n";
+    }
+
+    const std::string&& tmpName = fileName + ".tmp";
+    std::ofstream ofs(tmpName, std::ios::trunc);
+    ofs << oss.str();
+    ofs.close();
+    return ofs && std::rename(tmpName.c_str(), fileName.c_str()) == 0;
+}
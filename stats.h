@@ -0,0 +1,106 @@
+/* XDGSearch is a XAPIAN based file indexer and search tool.
+
+    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef XDGSEARCH_INCLUDED_STATS_H
+#define XDGSEARCH_INCLUDED_STATS_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <chrono>
+#include "trace.h"
+
+namespace XDGSearch {
+class BuildStats;           /// where a build spends its time: by stage, by helper and by file extension
+std::string jsonString(const std::string&); /// quoted and escaped JSON string
+}
+
+/// The stages overlap: the walker crawls while the helpers run and the main thread stores documents, so their
+/// times don't add up to the build time. WALK is the time the main thread waited for the walker, HELPERRUN spans
+/// from popen() to pclose() and holds SPAWN and PIPEREAD, SPLIT is indexDocuments() but INDEXTEXT and ADDDOCUMENT.
+class XDGSearch::BuildStats final {
+public:
+    enum Stage { WALK, SPAWN, HELPERRUN, PIPEREAD, SPLIT, INDEXTEXT, ADDDOCUMENT, COMMIT, COMPACT, STAGES };
+    class Histogram;
+    class Timer;
+    BuildStats();
+    BuildStats(BuildStats&&) = delete;
+    BuildStats& operator=(BuildStats&&) = delete;
+    ~BuildStats() = default;
+    void add(Stage, unsigned long long);    /// thread safe, nanoseconds
+    void addFile( const std::string&        /// thread safe: helper name
+                , const std::string&        /// file name, its extension is taken
+                , unsigned long long        /// nanoseconds spent getting the text
+                , unsigned long long );     /// bytes of text
+    void setCounter(const std::string&, unsigned long long);    /// e.g.: files, text cache hits
+    void addCounter(const std::string&, unsigned long long);    /// thread safe, it adds to the counter
+    bool save(const std::string&) const;    /// JSON summary, written aside then renamed
+    static const char* stageName(Stage);
+    static unsigned long long allocations();    /// the heap allocations of the calling thread so far, see countsAllocations
+#ifdef XDGSEARCH_COUNT_ALLOCATIONS
+    static constexpr bool countsAllocations = true;
+#else
+    static constexpr bool countsAllocations = false;     /// built without CONFIG+=countallocations
+#endif
+private:
+    mutable std::mutex m;
+    std::vector<Histogram> stages;
+    std::map<std::string, std::pair<Histogram, Histogram>> helpers, extensions;     /// latency and bytes
+    std::vector<std::pair<std::string, unsigned long long>> counters;
+    const std::chrono::steady_clock::time_point start;
+};
+
+/// Power of two buckets: bucket n counts the values from 2^n to 2^(n+1)-1, value 0 falls into bucket 0.
+class XDGSearch::BuildStats::Histogram final {
+public:
+    Histogram();
+    void add(unsigned long long);
+    std::string toJson() const;
+    unsigned long long getCount() const     { return count; }
+    unsigned long long getTotal() const     { return total; }
+private:
+    unsigned long long buckets[64];
+    unsigned long long count, total, max;
+};
+
+/// It adds the time elapsed since its construction to a stage and, while tracing, it records a span of the
+/// stage: nothing of the two when built with a nullptr and tracing is off
+class XDGSearch::BuildStats::Timer final {
+public:
+    Timer(BuildStats* s, Stage st) :
+        stats(s), stage(st), t0(s || Trace::isEnabled() ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point())    {}
+    Timer(Timer&&) = delete;
+    Timer& operator=(Timer&&) = delete;
+    ~Timer()
+    {
+        if(t0 == std::chrono::steady_clock::time_point())
+            return;
+        const auto&& t1 = std::chrono::steady_clock::now();
+        if(stats)
+            stats ->add(stage, std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+        Trace::record(stageName(stage), t0, t1);
+    }
+    unsigned long long elapsed() const      { return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count(); }
+private:
+    BuildStats* const stats;
+    const Stage stage;
+    const std::chrono::steady_clock::time_point t0;
+};
+
+#endif /// XDGSEARCH_INCLUDED_STATS_H
@@ -0,0 +1,84 @@
+/* XDGSearch is a XAPIAN based file indexer and search tool.
+
+    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "stemcache.h"
+#include <chrono>
+#include <map>
+#include <unordered_map>
+
+namespace {
+thread_local XDGSearch::StemCache::Counters threadCounters = { 0, 0, 0 };
+
+using cacheType = std::unordered_map<std::string, std::string>;     /// word, stem
+
+cacheType& localCache(const std::string& language)
+{
+    thread_local std::map<std::string, cacheType> caches;
+    thread_local std::pair<const std::string, cacheType>* last = nullptr;   /// a build or a query keeps the same language
+    if(!last || last ->first != language)   {
+        auto&& it = caches.find(language);
+        if(it == caches.end())
+            it = caches.emplace(language, cacheType()).first;
+        last = &*it;
+    }
+    return last ->second;
+}
+}
+
+XDGSearch::StemCache::StemCache(const std::string& l) :
+    stemmer(l), language(l)     /// Xapian::Stem throws on an unknown language, so does the cache
+{
+}
+
+std::string XDGSearch::StemCache::operator()(const std::string& word)
+{
+    cacheType& cache = localCache(language);
+    const auto&& it = cache.find(word);
+    if(it != cache.end())   {
+        ++threadCounters.hits;
+        return it ->second;
+    }
+
+    const auto&& t0 = std::chrono::steady_clock::now();
+    std::string stem = stemmer(word);
+    threadCounters.missNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+    ++threadCounters.misses;
+    if(word.size() <= maxWordSize)  {
+        if(cache.size() >= maxEntries)
+            cache.clear();      /// the buckets are kept, the frequent words come back at once
+        cache.emplace(word, stem);
+    }
+    return stem;
+}
+
+std::string XDGSearch::StemCache::get_description() const
+{
+    return "XDGSearch::StemCache(" + stemmer.get_description() + ")";
+}
+
+XDGSearch::StemCache::Counters XDGSearch::StemCache::counters()
+{
+    return threadCounters;
+}
+
+Xapian::Stem XDGSearch::cachedStem(const std::string& language)
+{
+    if(language.empty() || language == "none")
+        return Xapian::Stem(language);      /// is_none() must stay true, or the TermGenerator adds "Z" terms
+    return Xapian::Stem(new XDGSearch::StemCache(language));    /// the Stem owns it
+}
@@ -0,0 +1,50 @@
+/* XDGSearch is a XAPIAN based file indexer and search tool.
+
+    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef XDGSEARCH_INCLUDED_STEMCACHE_H
+#define XDGSEARCH_INCLUDED_STEMCACHE_H
+
+#include <xapian.h>
+#include <string>
+
+namespace XDGSearch {
+class StemCache;            /// a Snowball stemmer fronted by a cache of the words already stemmed
+Xapian::Stem cachedStem(const std::string&);    /// language, "none" gives the plain Xapian::Stem that stems nothing
+}
+
+/// Natural language text repeats the same words over and over, the cache spares Snowball all but the first of
+/// them. The caches are thread local, one for each language, so the TermGenerator of a build and the QueryParser
+/// of each query share them without locking and they outlive both. A cache holding maxEntries words is emptied.
+class XDGSearch::StemCache final : public Xapian::StemImplementation {
+public:
+    struct Counters { unsigned long long hits, misses, missNanoseconds; };
+    static const std::size_t maxEntries = 1 << 16;
+    static const std::size_t maxWordSize = 64;          /// bytes, longer words are stemmed but not cached
+    explicit StemCache(const std::string&);             /// language, see Xapian::Stem::get_available_languages()
+    StemCache(StemCache&&) = delete;
+    StemCache& operator=(StemCache&&) = delete;
+    ~StemCache() = default;
+    std::string operator()(const std::string&) override;
+    std::string get_description() const override;
+    static Counters counters();     /// of the calling thread so far, all languages
+private:
+    Xapian::Stem stemmer;
+    const std::string language;
+};
+
+#endif /// XDGSEARCH_INCLUDED_STEMCACHE_H
@@ -0,0 +1,81 @@
+/* XDGSearch is a XAPIAN based file indexer and search tool.
+
+    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "stopwords.h"
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <cstdlib>
+#include <climits>
+#include <sys/stat.h>
+
+namespace {
+using entryType = std::tuple<long long, long long, long long, std::shared_ptr<const XDGSearch::StopWords>>;   /// mtime s, ns, size
+}
+
+XDGSearch::StopWords::StopWords(std::vector<std::string>&& w) :
+    words(std::move(w))
+{
+}
+
+std::shared_ptr<const XDGSearch::StopWords> XDGSearch::StopWords::load(const std::string& fileName)
+{
+    static std::mutex m;
+    static std::map<std::string, entryType> registry;   /// by absolute path
+
+    char resolved[PATH_MAX];
+    struct stat st;
+    if(!::realpath(fileName.c_str(), resolved) || ::stat(resolved, &st) != 0 || !S_ISREG(st.st_mode))
+        return nullptr;
+
+    std::lock_guard<std::mutex> lk(m);
+    auto& entry = registry[resolved];
+    if( std::get<3>(entry)
+     && std::get<0>(entry) == st.st_mtim.tv_sec
+     && std::get<1>(entry) == st.st_mtim.tv_nsec
+     && std::get<2>(entry) == st.st_size )
+        return std::get<3>(entry);      /// unchanged since it was read
+
+    std::ifstream ifs(resolved);
+    if(!ifs)
+        return nullptr;
+    std::vector<std::string> w;
+    for(std::string s; std::getline(ifs, s); /* null */)    {
+        s.erase(s.find_last_not_of(" \t\r") + 1);   /// files edited elsewhere may have trailing blanks
+        if(!s.empty())
+            w.push_back(s);
+    }
+    std::sort(w.begin(), w.end());
+    w.erase(std::unique(w.begin(), w.end()), w.end());
+    w.shrink_to_fit();
+    entry = std::make_tuple( st.st_mtim.tv_sec, st.st_mtim.tv_nsec, st.st_size
+                           , std::shared_ptr<const StopWords>(new StopWords(std::move(w))) );
+    return std::get<3>(entry);
+}
+
+bool XDGSearch::StopWords::operator()(const std::string& word) const
+{
+    return std::binary_search(words.begin(), words.end(), word);
+}
+
+std::string XDGSearch::StopWords::get_description() const
+{
+    return "XDGSearch::StopWords(" + std::to_string(words.size()) + " words)";
+}
@@ -0,0 +1,48 @@
+/* XDGSearch is a XAPIAN based file indexer and search tool.
+
+    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef XDGSEARCH_INCLUDED_STOPWORDS_H
+#define XDGSEARCH_INCLUDED_STOPWORDS_H
+
+#include <xapian.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace XDGSearch {
+class StopWords;            /// an immutable stop-words list shared by the builds and the queries of the process
+}
+
+/// Each file is read once into a sorted flat array, searched by bisection, and handed out again until its mtime
+/// or its size change. The object is const once built, so the builds running at once and the queries share it
+/// without locking, the registry is locked only by load().
+class XDGSearch::StopWords final : public Xapian::Stopper {
+public:
+    static std::shared_ptr<const StopWords> load(const std::string&);   /// file name, nullptr if it can't be read
+    StopWords(StopWords&&) = delete;
+    StopWords& operator=(StopWords&&) = delete;
+    ~StopWords() = default;
+    bool operator()(const std::string&) const override;     /// true for a stop-word
+    std::string get_description() const override;
+    std::size_t size() const        { return words.size(); }
+private:
+    explicit StopWords(std::vector<std::string>&&);
+    const std::vector<std::string> words;
+};
+
+#endif /// XDGSEARCH_INCLUDED_STOPWORDS_H
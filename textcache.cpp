@@ -0,0 +1,170 @@
+/* XDGSearch is a XAPIAN based file indexer and search tool.
+
+    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "textcache.h"
+#include "journal.h"
+#include <QByteArray>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <tuple>
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+namespace {
+const std::string magic = "XDGTC1\n";
+}
+
+XDGSearch::TextCache::TextCache(const std::string& d, unsigned long long bound) :
+      dir(d)
+    , maxBytes(bound)
+    , totalBytes(0)
+    , hits(0)
+    , misses(0)
+{
+    if(!maxBytes)
+        return;
+    ::mkdir(dir.c_str(), 0700);     /// helpers' output is as private as the files it comes from
+    totalBytes = scan();
+}
+
+XDGSearch::TextCache::~TextCache()
+{
+    if(maxBytes && totalBytes > maxBytes)
+        trim();
+}
+
+std::string XDGSearch::TextCache::key( unsigned long long contentHash
+                                     , unsigned long long size
+                                     , const std::string& commandLine )
+{
+    return std::to_string(contentHash) + '\0' + std::to_string(size) + '\0' + commandLine;
+}
+
+std::string XDGSearch::TextCache::entryName(const std::string& k) const
+{
+    char hex[17];
+    std::snprintf(hex, sizeof hex, "%016llx", XDGSearch::Journal::signature(k));
+    return dir + "/" + std::string(hex, 2) + "/" + std::string(hex + 2);
+}
+
+bool XDGSearch::TextCache::find(const std::string& k, std::string& text)
+{
+    if(!maxBytes)
+        return false;
+    const std::string&& name = entryName(k);
+    std::ifstream ifs(name, std::ios::binary);
+    const std::string contents((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    const std::string&& header = magic + std::to_string(k.size()) + '\n' + k;
+    if(contents.compare(0, header.size(), header) != 0)  {   /// missing, or another key with the same hash
+        ++misses;
+        return false;
+    }
+
+    const std::size_t&& zSize = contents.size() - header.size();
+    if(zSize)   {
+        const QByteArray&& out = qUncompress(reinterpret_cast<const uchar*>(contents.data() + header.size()), zSize);
+        if(out.isEmpty())   {   /// damaged entry
+            ++misses;
+            return false;
+        }
+        text.assign(out.constData(), out.size());
+    } else
+        text.clear();           /// the helper printed nothing
+
+    ::utimensat(AT_FDCWD, name.c_str(), nullptr, 0);    /// the mtime tells when the entry was used last
+    ++hits;
+    return true;
+}
+
+void XDGSearch::TextCache::store(const std::string& k, const std::string& text)
+{
+    if(!maxBytes || text.size() > INT_MAX)
+        return;
+    const std::string&& name = entryName(k);
+    ::mkdir(name.substr(0, name.rfind('/')).c_str(), 0700);
+
+    std::string tmpName = name + ".XXXXXX";     /// written aside then renamed: readers never see a partial entry
+    const int&& fd = ::mkstemp(&tmpName[0]);
+    if(fd < 0)
+        return;
+    const QByteArray&& z = text.empty() ? QByteArray()
+                                        : qCompress(reinterpret_cast<const uchar*>(text.data()), text.size(), 1);   /// the fastest level, extraction text shrinks well anyway
+    const std::string&& header = magic + std::to_string(k.size()) + '\n' + k;
+    bool ok = ::write(fd, header.data(), header.size()) == static_cast<ssize_t>(header.size())
+           && ::write(fd, z.constData(), z.size()) == static_cast<ssize_t>(z.size());
+    ok = (::close(fd) == 0) && ok;
+    if(!ok || ::rename(tmpName.c_str(), name.c_str()) != 0)  {
+        ::unlink(tmpName.c_str());
+        return;
+    }
+
+    bool overflow;
+    {
+        std::lock_guard<std::mutex> lk(m);
+        totalBytes += header.size() + z.size();
+        overflow = totalBytes > maxBytes / 4 * 5;   /// a quarter of slack keeps trimming rare
+    }
+    if(overflow)
+        trim();
+}
+
+unsigned long long XDGSearch::TextCache::scan(std::vector<entryType>* entries) const
+{
+    unsigned long long retval = 0;
+    DIR* top = ::opendir(dir.c_str());
+    if(!top)
+        return 0;
+    for(dirent* sub; (sub = ::readdir(top)); /* null */)  {
+        if(sub ->d_name[0] == '.')
+            continue;
+        const std::string&& subName = dir + "/" + sub ->d_name;
+        DIR* d = ::opendir(subName.c_str());
+        if(!d)
+            continue;
+        struct stat st;
+        for(dirent* e; (e = ::readdir(d)); /* null */)
+            if(e ->d_name[0] != '.' && ::fstatat(::dirfd(d), e ->d_name, &st, 0) == 0)  {
+                retval += st.st_size;
+                if(entries)
+                    entries ->emplace_back(st.st_mtim.tv_sec * 1000000000ll + st.st_mtim.tv_nsec, st.st_size, subName + "/" + e ->d_name);
+            }
+        ::closedir(d);
+    }
+    ::closedir(top);
+    return retval;
+}
+
+void XDGSearch::TextCache::trim()
+{
+    std::lock_guard<std::mutex> lk(m);
+    std::vector<entryType> entries;
+    unsigned long long total = scan(&entries);
+
+    std::sort(entries.begin(), entries.end());  /// least recently used first
+    for(auto e = entries.cbegin(); e != entries.cend() && total > maxBytes / 10 * 9; ++e)  /// some room for the next entries
+        if(::unlink(std::get<2>(*e).c_str()) == 0)
+            total -= std::get<1>(*e);
+    totalBytes = total;
+}
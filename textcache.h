@@ -0,0 +1,64 @@
+/* XDGSearch is a XAPIAN based file indexer and search tool.
+
+    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef XDGSEARCH_INCLUDED_TEXTCACHE_H
+#define XDGSEARCH_INCLUDED_TEXTCACHE_H
+
+#include <string>
+#include <vector>
+#include <tuple>
+#include <mutex>
+#include <atomic>
+
+namespace XDGSearch {
+class TextCache;            /// compressed helpers' output, it spares running the helpers again on rebuilds
+}
+
+/// Each entry holds the output a helper gave for a file, it's named after a hash of the key: the hash of the file
+/// contents, its size and the helper command line, so a changed file or helper never hits a stale entry, while
+/// copies of the same file, in the same pool or in another one, share the entry. Entries are
+/// compressed with qCompress() and spread over 256 sub-directories. A hit refreshes the entry mtime, which is
+/// what the least recently used eviction goes by once the cache grows beyond its bound.
+class XDGSearch::TextCache final {
+public:
+    TextCache(const std::string&, unsigned long long);  /// directory, bound in bytes: 0 disables the cache
+    TextCache(TextCache&&) = delete;
+    TextCache& operator=(TextCache&&) = delete;
+    ~TextCache();                           /// evicts what exceeds the bound
+    bool find(const std::string&, std::string&);        /// thread safe, true and the cached output on hit
+    void store(const std::string&, const std::string&); /// thread safe
+    void trim();                            /// least recently used entries are removed until the cache is below the bound
+    bool isEnabled() const                  { return maxBytes != 0; }
+    unsigned int getHits() const            { return hits; }
+    unsigned int getMisses() const          { return misses; }
+    static std::string key( unsigned long long      /// hash of the file contents
+                          , unsigned long long      /// size
+                          , const std::string& );   /// helper command line
+private:
+    using entryType = std::tuple<long long, unsigned long long, std::string>;   /// last use, size, name
+    std::string entryName(const std::string&) const;
+    unsigned long long scan(std::vector<entryType>* = nullptr) const;   /// bytes held by the entries, optionally listed
+
+    const std::string dir;
+    const unsigned long long maxBytes;
+    std::mutex m;
+    unsigned long long totalBytes;          /// estimate: other processes may share the directory
+    std::atomic<unsigned int> hits, misses;
+};
+
+#endif /// XDGSEARCH_INCLUDED_TEXTCACHE_H
@@ -0,0 +1,142 @@
+/* XDGSearch is a XAPIAN based file indexer and search tool.
+
+    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "trace.h"
+#include "stats.h"      /// used for jsonString()
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <fstream>
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+struct event {
+    const char* name;
+    long long begin, end;                   /// nanoseconds since Trace::start()
+    char detail[XDGSearch::Trace::detailSize];
+};
+
+struct threadBuffer {
+    unsigned int track;
+    std::vector<event> events;              /// a ring of ringSize spans
+    unsigned long long recorded;            /// the next is written at recorded % ringSize
+};
+
+std::mutex registryMutex;                   /// it guards the two containers below, never the recording
+std::vector<std::unique_ptr<threadBuffer>> buffers;
+std::vector<threadBuffer*> freeBuffers;     /// left by exited threads
+XDGSearch::Trace::clockType::time_point origin;
+
+struct bufferHolder {                       /// it gives the buffer back when its thread exits
+    threadBuffer* buffer = nullptr;
+    ~bufferHolder()
+    {
+        if(!buffer)
+            return;
+        std::lock_guard<std::mutex> lk(registryMutex);
+        freeBuffers.push_back(buffer);
+    }
+};
+thread_local bufferHolder holder;
+
+threadBuffer* ownBuffer()
+{
+    if(holder.buffer)
+        return holder.buffer;
+    std::lock_guard<std::mutex> lk(registryMutex);
+    if(!freeBuffers.empty())    {
+        holder.buffer = freeBuffers.back();
+        freeBuffers.pop_back();
+    } else  {
+        buffers.emplace_back(new threadBuffer);
+        holder.buffer = buffers.back().get();
+        holder.buffer ->track = buffers.size();     /// 1 is the thread that called start()
+        holder.buffer ->events.resize(XDGSearch::Trace::ringSize);
+        holder.buffer ->recorded = 0;
+    }
+    return holder.buffer;
+}
+
+long long sinceOrigin(const XDGSearch::Trace::clockType::time_point& t)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t - origin).count();
+}
+}
+
+std::atomic<bool> XDGSearch::Trace::enabled(false);
+const std::string XDGSearch::Trace::Span::empty;
+
+void XDGSearch::Trace::start()
+{
+    origin = clockType::now();
+    ownBuffer();
+    enabled = true;
+}
+
+void XDGSearch::Trace::record( const char* name
+                             , clockType::time_point begin
+                             , clockType::time_point end
+                             , const std::string& detail )
+{
+    if(!isEnabled())
+        return;
+    threadBuffer* const b = ownBuffer();
+    event& e = b ->events[b ->recorded++ % ringSize];   /// the oldest span once the ring is full
+    e.name = name;
+    e.begin = sinceOrigin(begin);
+    e.end = sinceOrigin(end);
+    std::size_t from = detail.size() < detailSize ? 0 : detail.size() - (detailSize - 1);  /// of a path the end tells the most
+    while(from < detail.size() && (static_cast<unsigned char>(detail[from]) & 0xC0) == 0x80)
+        ++from;     /// not inside a UTF-8 character
+    std::memcpy(e.detail, detail.data() + from, detail.size() - from);
+    e.detail[detail.size() - from] = '\0';
+}
+
+bool XDGSearch::Trace::save(const std::string& fileName)
+{
+    enabled = false;
+    std::lock_guard<std::mutex> lk(registryMutex);
+    std::ofstream ofs(fileName, std::ios::trunc);
+    ofs << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    char ts[64];
+    unsigned long long overwritten = 0;
+    for(const auto& b : buffers)    {
+        const unsigned long long&& lost = b ->recorded > ringSize ? b ->recorded - ringSize : 0;
+        overwritten += lost;
+        ofs << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << b ->track
+            << ",\"args\":{\"name\":\"" << (b ->track == 1 ? std::string("main") : "worker " + std::to_string(b ->track - 1))
+            << "\",\"overwritten\":" << lost << "}}";
+        first = false;
+        for(unsigned long long i = lost; i != b ->recorded; ++i)    {   /// complete events, oldest first, times in microseconds
+            const event& e = b ->events[i % ringSize];
+            std::snprintf(ts, sizeof ts, "\"ts\":%.3f,\"dur\":%.3f", e.begin / 1e3, (e.end - e.begin) / 1e3);
+            ofs << ",\n{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << b ->track << "," << ts;
+            if(e.detail[0])
+                ofs << ",\"args\":{\"file\":" << XDGSearch::jsonString(e.detail) << "}";
+            ofs << "}";
+        }
+        b ->recorded = 0;
+    }
+    if(overwritten)
+        std::clog << fileName << ": the " << overwritten << " oldest spans were overwritten, each thread keeps its last " << ringSize << std::endl;
+    ofs << "\n]}\n";
+    return static_cast<bool>(ofs);
+}
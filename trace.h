@@ -0,0 +1,70 @@
+/* XDGSearch is a XAPIAN based file indexer and search tool.
+
+    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef XDGSEARCH_INCLUDED_TRACE_H
+#define XDGSEARCH_INCLUDED_TRACE_H
+
+#include <string>
+#include <chrono>
+#include <atomic>
+#include <cstddef>
+
+namespace XDGSearch {
+class Trace;                /// spans of the indexing steps, saved in the Chrome trace-event format
+}
+
+/// Each thread writes its spans into a ring of its own, with neither locks nor atomic operations: a mutex is
+/// taken only when a thread records its first span and when it exits. The ring is allocated once and a span
+/// copies the tail of its detail into a fixed field, so recording never allocates; once the ring is full the
+/// oldest spans are overwritten and the saved trace tells how many. The buffer of an exited thread is handed to
+/// the next new thread, so a track of the trace is a worker slot rather than a short lived std::async thread.
+/// The file opens with https://ui.perfetto.dev or chrome://tracing.
+class XDGSearch::Trace final {
+public:
+    using clockType = std::chrono::steady_clock;
+    class Span;
+    static void start();                    /// spans are recorded from now on, the calling thread is the "main" track
+    static bool isEnabled()                 { return enabled.load(std::memory_order_relaxed); }
+    static const std::size_t ringSize = 16384;     /// spans kept by each thread, the latest ones
+    static const std::size_t detailSize = 56;      /// bytes of a detail kept, its end, with the terminating null
+    static void record( const char*         /// span name, a string literal
+                      , clockType::time_point
+                      , clockType::time_point
+                      , const std::string& = std::string() );   /// optional detail, e.g.: the file name
+    static bool save(const std::string&);   /// it stops recording, call it once the traced threads are done
+private:
+    static std::atomic<bool> enabled;
+};
+
+/// It records a span from its construction to its destruction, nothing while tracing is off. The detail isn't
+/// copied: it must outlive the span
+class XDGSearch::Trace::Span final {
+public:
+    explicit Span(const char* n, const std::string& d = empty) :
+        name(n), detail(d), t0(isEnabled() ? clockType::now() : clockType::time_point()) {}
+    Span(Span&&) = delete;
+    Span& operator=(Span&&) = delete;
+    ~Span()                                 { if(t0 != clockType::time_point()) record(name, t0, clockType::now(), detail); }
+private:
+    static const std::string empty;
+    const char* const name;
+    const std::string& detail;
+    const clockType::time_point t0;
+};
+
+#endif /// XDGSEARCH_INCLUDED_TRACE_H
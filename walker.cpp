@@ -0,0 +1,643 @@
+/* XDGSearch is a XAPIAN based file indexer and search tool.
+
+    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "walker.h"
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cctype>
+#include <algorithm>
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <dirent.h>
+
+namespace {
+long long mtimeOf(const struct stat& st)
+{
+    return st.st_mtim.tv_sec * 1000000000ll + st.st_mtim.tv_nsec;
+}
+
+struct linuxDirent64 {          /// the record getdents64(2) fills, glibc exposes no wrapper before 2.30
+    ino64_t        d_ino;
+    off64_t        d_off;
+    unsigned short d_reclen;
+    unsigned char  d_type;
+    char           d_name[];
+};
+}
+
+
+bool XDGSearch::globMatch(const char* p, const char* s)
+{
+    while(*p)   {
+        if(p[0] == '*' && p[1] == '*')  {
+            p += 2;
+            if(*p == '/')   {   /// "**/" matches zero or more leading directories
+                ++p;
+                for(const char* t = s; ; ++t)   {
+                    if(globMatch(p, t))
+                        return true;
+                    t = std::strchr(t, '/');
+                    if(!t)
+                        return false;
+                }
+            }
+            for(const char* t = s; ; ++t)   {   /// any other "**" matches everything, slashes included
+                if(globMatch(p, t))
+                    return true;
+                if(!*t)
+                    return false;
+            }
+        }
+        if(*p == '*')   {       /// "*" matches everything but a slash
+            ++p;
+            for(const char* t = s; ; ++t)   {
+                if(globMatch(p, t))
+                    return true;
+                if(!*t || *t == '/')
+                    return false;
+            }
+        }
+        if(!*s)
+            return false;
+        if(*p == '?')   {
+            if(*s == '/')
+                return false;
+            ++p;    ++s;
+            continue;
+        }
+        if(*p == '[')   {       /// character class: [abc], [a-z], [!a-z]
+            const char* q = p + 1;
+            const bool negated = (*q == '!' || *q == '^');
+            if(negated)
+                ++q;
+            const char* const close = *q ? std::strchr(q + 1, ']') : nullptr;   /// a ']' first in the class is an ordinary character
+            if(close)   {       /// otherwise unterminated: '[' is an ordinary character
+                bool found = false;
+                while(q != close)   {
+                    if(q + 2 < close && q[1] == '-')   {
+                        if(*s >= q[0] && *s <= q[2])
+                            found = true;
+                        q += 3;
+                    } else  {
+                        if(*s == *q)
+                            found = true;
+                        ++q;
+                    }
+                }
+                if(found == negated || *s == '/')
+                    return false;
+                p = close + 1;  ++s;
+                continue;
+            }
+        }
+        if(*p == '\\' && p[1])
+            ++p;
+        if(*p != *s)
+            return false;
+        ++p;    ++s;
+    }
+    return !*s;
+}
+
+void XDGSearch::IgnoreRules::addPattern(std::string line)
+{
+    while(!line.empty() && (line.back() == '\r' || line.back() == '\n'))
+        line.pop_back();
+    while(line.size() > 1 && line.back() == ' ' && line[line.size() - 2] != '\\')   /// trailing spaces are ignored unless escaped
+        line.pop_back();
+    if(line.empty() || line.front() == '#')     /// blank lines and comments
+        return;
+
+    rule r { std::string(), false, false, false };
+    if(line.front() == '!') {
+        r.negated = true;
+        line.erase(0, 1);
+    } else if(line.compare(0, 2, "\\!") == 0 || line.compare(0, 2, "\\#") == 0)
+        line.erase(0, 1);
+    if(!line.empty() && line.back() == '/') {
+        r.dirOnly = true;
+        line.pop_back();
+    }
+    if(line.find('/') != std::string::npos) {
+        r.anchored = true;
+        if(line.front() == '/')
+            line.erase(0, 1);
+    }
+    if(line.empty())
+        return;
+    r.pattern = line;
+    rules.push_back(r);
+}
+
+bool XDGSearch::IgnoreRules::loadFile(const std::string& fileName)
+{
+    std::ifstream ifs(fileName);
+    if(!ifs)
+        return false;
+    for(std::string line; std::getline(ifs, line); /* null */)
+        addPattern(line);
+    return true;
+}
+
+XDGSearch::IgnoreRules::Match XDGSearch::IgnoreRules::match(const std::string& relPath, bool isDir) const
+{
+    std::string path = relPath;     /// make the path relative to the directory holding the ignore file
+    if(!base.empty())   {
+        if(relPath.compare(0, base.size(), base) != 0 || relPath.size() <= base.size() || relPath[base.size()] != '/')
+            return Match::NONE;
+        path = relPath.substr(base.size() + 1);
+    }
+    const auto&& slash = path.find_last_of('/');
+    const std::string name = (slash == std::string::npos) ? path : path.substr(slash + 1);
+
+    for(auto r = rules.crbegin(); r != rules.crend(); ++r)  {   /// the last matching pattern is decisive
+        if(r ->dirOnly && !isDir)
+            continue;
+        if(globMatch(r ->pattern.c_str(), r ->anchored ? path.c_str() : name.c_str()))
+            return r ->negated ? Match::INCLUDED : Match::EXCLUDED;
+    }
+    return Match::NONE;
+}
+
+XDGSearch::Walker::Walker( const std::string& poolDirPath
+                         , const std::vector<std::string>& helpersExtensions
+                         , const walkerType& w
+                         , unsigned int threadsNumber
+                         , const Journal* prev
+                         , Journal* cur
+                         , const std::string& subtree) :
+      extensions(helpersExtensions)
+    , maxDepth(std::get<MAXDEPTH>(w))
+    , maxFileSize(std::get<MAXFILESIZE>(w))
+    , skipHidden(std::get<SKIPHIDDEN>(w))
+    , previous(prev)
+    , current(cur)
+    , outstandingTasks(0)
+    , queuedTasks(0)
+    , runningCrawlers(0)
+    , idleCrawlers(0)
+    , stopped(false)
+    , hasPending(false)
+    , currentHelper(0)
+    , visitedDirs(SHARDS)
+    , visitedFiles(SHARDS)
+    , foundFiles(0)
+    , prunedDirectories(0)
+    , skippedFiles(0)
+{
+    std::string root = poolDirPath;
+    while(root.size() > 1 && root.back() == '/')    /// avoids double slashes into the yielded file names
+        root.pop_back();
+
+    if(!threadsNumber)  /// crawling is mostly waiting for the disk: a few threads more than cores keep it busy
+        threadsNumber = std::min(16u, std::max(2u, std::thread::hardware_concurrency()));
+    for(unsigned int i = 0; i != threadsNumber; ++i)
+        queues.emplace_back(new taskQueue);
+
+    if(!root.empty() && subtree.empty())
+        pushTask(0, dirTask { root, "", 0, poolIgnoreRules(w), false });
+    else if(!root.empty())
+        startAt(root, subtree, poolIgnoreRules(w));
+
+    runningCrawlers = threadsNumber;
+    for(unsigned int i = 0; i != threadsNumber; ++i)
+        crawlers.emplace_back(&Walker::crawler, this, i);
+}
+
+XDGSearch::Walker::~Walker()
+{
+    stop();
+    for(auto& t : crawlers)
+        t.join();
+}
+
+void XDGSearch::Walker::stop()
+{
+    stopped = true;
+    {
+        std::lock_guard<std::mutex> lk(outMutex);
+        found.clear();
+    }
+    outRoom.notify_all();
+    outReady.notify_all();
+    {
+        std::lock_guard<std::mutex> lk(idleMutex);
+    }
+    idleCv.notify_all();
+}
+
+void XDGSearch::Walker::wakeIdle(bool all)
+{
+    if(idleCrawlers == 0)   /// a crawler about to wait counts itself first, then it checks the tasks
+        return;
+    {
+        std::lock_guard<std::mutex> lk(idleMutex);  /// a crawler between its check and its wait is waiting once this is taken
+    }
+    if(all)
+        idleCv.notify_all();
+    else
+        idleCv.notify_one();
+}
+
+void XDGSearch::Walker::pushTask(unsigned int id, dirTask&& t)
+{
+    ++outstandingTasks;     /// counted before it is visible: a crawler can't see zero while a task is queued
+    {
+        std::lock_guard<std::mutex> lk(queues[id] ->m);
+        queues[id] ->tasks.push_back(std::move(t));
+        ++queuedTasks;
+    }
+    wakeIdle(false);
+}
+
+bool XDGSearch::Walker::popTask(unsigned int id, dirTask& t)
+{
+    {   /// depth first on the own queue keeps the directory names hot into the cache
+        std::lock_guard<std::mutex> lk(queues[id] ->m);
+        if(!queues[id] ->tasks.empty()) {
+            t = std::move(queues[id] ->tasks.back());
+            queues[id] ->tasks.pop_back();
+            --queuedTasks;
+            return true;
+        }
+    }
+    for(std::size_t i = 1; i != queues.size(); ++i)     {   /// breadth first when stealing: the oldest tasks are the biggest subtrees
+        auto& q = *queues[(id + i) % queues.size()];
+        std::lock_guard<std::mutex> lk(q.m);
+        if(!q.tasks.empty())    {
+            t = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            --queuedTasks;
+            return true;
+        }
+    }
+    return false;
+}
+
+void XDGSearch::Walker::startAt(const std::string& root, const std::string& subtree, std::shared_ptr<const IgnoreNode> rules)
+{
+    std::string path = root, relPath;
+    unsigned int depth = 0;
+    for(std::size_t begin = 0; /* null */; /* null */)  {   /// down from the pool directory, as the crawlers would go
+        rules = withIgnoreFiles(rules, path, relPath);
+        const std::size_t&& slash = subtree.find('/', begin);
+        const std::string&& name = subtree.substr(begin, slash == std::string::npos ? slash : slash - begin);
+        relPath = subtree.substr(0, slash);
+        path += "/" + name;
+        struct stat st;
+        if(name.empty() || ::stat(path.c_str(), &st) != 0)
+            return;
+        if(S_ISDIR(st.st_mode)) {
+            if((skipHidden && name.front() == '.') || (maxDepth && depth + 1 > maxDepth) || isIgnored(rules.get(), relPath, true))  {
+                ++prunedDirectories;
+                return;
+            }
+            ++depth;
+            if(slash == std::string::npos)  {   /// its own ignore files are read by the crawler
+                pushTask(0, dirTask { path, relPath, depth, rules, false });
+                return;
+            }
+            begin = slash + 1;
+            continue;
+        }
+        if(slash != std::string::npos || !S_ISREG(st.st_mode))
+            return;
+        const int helper = extensions.match(name);
+        if(helper < 0)
+            return;
+        if((maxFileSize && static_cast<unsigned long long>(st.st_size) > maxFileSize) || isIgnored(rules.get(), relPath, false))
+            ++skippedFiles;
+        else
+            yield(std::move(path), helper);
+        return;
+    }
+}
+
+void XDGSearch::Walker::crawler(unsigned int id)
+{
+    for(dirTask t; !stopped; /* null */)    {
+        if(popTask(id, t))  {
+            crawlDirectory(id, t);
+            t.rules.reset();
+            if(--outstandingTasks == 0)     /// the tree was walked but the sym-linked directories
+                nextPhase(id);
+            continue;
+        }
+        if(outstandingTasks == 0)   {
+            nextPhase(id);      /// it waits for the crawler running it
+            if(outstandingTasks == 0)
+                break;
+            continue;
+        }
+        std::unique_lock<std::mutex> lk(idleMutex);
+        ++idleCrawlers;
+        idleCv.wait(lk, [this] { return stopped || queuedTasks != 0 || outstandingTasks == 0; });
+        --idleCrawlers;
+    }
+    if(--runningCrawlers == 0)  {   /// the last crawler quitting tells the consumer there is nothing more
+        std::lock_guard<std::mutex> lk(outMutex);
+        outReady.notify_all();
+    }
+}
+
+void XDGSearch::Walker::nextPhase(unsigned int id)
+{
+    std::lock_guard<std::mutex> lk(deferredMutex);
+    while(outstandingTasks == 0 && !linkedDirs.empty() && !stopped)  {
+        std::vector<std::pair<inodeType, dirTask>> dirs;
+        dirs.swap(linkedDirs);
+        std::sort( dirs.begin(), dirs.end()
+                 , [] (const std::pair<inodeType, dirTask>& a, const std::pair<inodeType, dirTask>& b) { return a.second.path < b.second.path; });
+        for(auto& d : dirs)     /// claimed in name order before they are read: the smallest name is the one walked
+            if(!isDuplicate(visitedDirs, d.first, d.second.path))
+                pushTask(id, std::move(d.second));
+    }
+    if(outstandingTasks != 0 || stopped)
+        return;
+
+    for(auto& f : linkedFiles)  {   /// all the names are known by now
+        auto& names = f.second;
+        std::sort(names.begin(), names.end());
+        std::string kept;
+        {
+            auto& shard = visitedFiles[inodeHash()(f.first) % visitedFiles.size()];
+            std::lock_guard<std::mutex> lk(shard.m);
+            const auto&& v = shard.visited.find(f.first);
+            if(v != shard.visited.end())    /// the target of sym-links, yielded already
+                kept = v ->second;
+        }
+        if(kept.empty())    {
+            kept = names.front().first;
+            yield(std::string(kept), names.front().second);
+        }
+        std::lock_guard<std::mutex> lk(duplicatesMutex);
+        for(const auto& n : names)
+            if(n.first != kept)
+                duplicates.emplace_back(n.first, kept);
+    }
+    linkedFiles.clear();
+    wakeIdle(true);     /// nothing is left: the idle crawlers quit
+}
+
+void XDGSearch::Walker::crawlDirectory(unsigned int id, const dirTask& t)
+{
+    const int fd = ::open(t.path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(fd < 0)
+        return;
+    struct stat st;
+    if(::fstat(fd, &st) != 0 || isDuplicate(visitedDirs, inodeType(st.st_dev, st.st_ino), t.path))  {    /// never walks the same directory twice,
+        ::close(fd);                                                                                    /// it bounds the walk to the real data size
+        return;
+    }
+    const dev_t dirDevice = st.st_dev;
+
+    long long ignoreStamp = 0;
+    for(const char* const ignoreFile : { ".gitignore", ".xdgsearchignore" })  {
+        struct stat ist;
+        if(::fstatat(fd, ignoreFile, &ist, 0) == 0)
+            ignoreStamp += mtimeOf(ist);
+    }
+
+    const Journal::dirRecord* const prevRecord = previous ? previous ->find(t.relPath) : nullptr;
+    /// no entry can be added, removed or renamed without changing the directory mtime: its listing is the journal's one
+    const bool fromJournal = prevRecord && !t.forceReaddir
+                          && prevRecord ->mtime == mtimeOf(st)
+                          && prevRecord ->inode == st.st_ino
+                          && prevRecord ->ignoreStamp == ignoreStamp;
+    const bool forceReaddir = t.forceReaddir || (prevRecord && prevRecord ->ignoreStamp != ignoreStamp);
+
+    struct dirEntry {
+        std::string name;
+        ino_t inode;
+        unsigned char type;
+    };
+    std::vector<dirEntry> entries;
+    if(fromJournal) {
+        for(const auto& f : prevRecord ->files)
+            entries.push_back(dirEntry { f.name, 0, DT_REG });
+        for(const auto& d : prevRecord ->subdirs)
+            entries.push_back(dirEntry { d, 0, DT_DIR });
+    } else  {
+        alignas(8) char buffer[32768];
+        for(long n; (n = ::syscall(SYS_getdents64, fd, buffer, sizeof(buffer))) > 0; /* null */)  {    /// reads a batch of entries per system call
+            for(long pos = 0; pos < n; /* null */)  {
+                const auto* const d = reinterpret_cast<const linuxDirent64*>(buffer + pos);
+                pos += d ->d_reclen;
+                if(d ->d_name[0] == '.' && (d ->d_name[1] == '\0' || (d ->d_name[1] == '.' && d ->d_name[2] == '\0')))
+                    continue;
+                entries.push_back(dirEntry { d ->d_name, static_cast<ino_t>(d ->d_ino), d ->d_type });
+            }
+        }
+    }
+
+    const std::shared_ptr<const IgnoreNode>&& rules = ignoreStamp ? withIgnoreFiles(t.rules, t.path, t.relPath) : t.rules;
+
+    std::unordered_map<std::string, const Journal::fileRecord*> prevFiles;
+    if(prevRecord)
+        for(const auto& f : prevRecord ->files)
+            prevFiles.emplace(f.name, &f);
+    Journal::dirRecord record { mtimeOf(st), st.st_ino, ignoreStamp, { }, { } };
+
+    for(auto& e : entries)  {
+        if(stopped)
+            break;
+        struct stat est;
+        bool statDone = false, viaLink = e.type == DT_LNK;
+        if(fromJournal || e.type == DT_UNKNOWN) {   /// the journal's entries tell no sym-link
+            if(::fstatat(fd, e.name.c_str(), &est, AT_SYMLINK_NOFOLLOW) != 0)
+                continue;
+            viaLink = S_ISLNK(est.st_mode);
+            statDone = !viaLink;
+        }
+        if(viaLink)  {   /// only here a stat is needed, it follows sym-links: the target is what counts
+            if(::fstatat(fd, e.name.c_str(), &est, 0) != 0)
+                continue;
+            statDone = true;
+        }
+        if(statDone)
+            e.type = S_ISDIR(est.st_mode) ? DT_DIR : S_ISREG(est.st_mode) ? DT_REG : DT_UNKNOWN;
+        std::string relName = t.relPath.empty() ? e.name : t.relPath + "/" + e.name;
+
+        if(e.type == DT_DIR)    {   /// journal's sub-directories already passed the rules, the rules didn't change since
+            if(skipHidden && e.name.front() == '.')     /// e.g. .git or .cache, the hidden files are walked
+                continue;
+            if(!fromJournal && ((maxDepth && t.depth + 1 > maxDepth) || isIgnored(rules.get(), relName, true)))   {   /// pruned: never descended into
+                ++prunedDirectories;
+                continue;
+            }
+            if(current)
+                record.subdirs.push_back(e.name);
+            dirTask&& sub = dirTask { t.path + "/" + e.name, std::move(relName), t.depth + 1, rules, forceReaddir };
+            if(viaLink) {   /// walked once the real directories are: their own names are kept
+                std::lock_guard<std::mutex> lk(deferredMutex);
+                linkedDirs.emplace_back(inodeType(est.st_dev, est.st_ino), std::move(sub));
+            } else
+                pushTask(id, std::move(sub));
+            continue;
+        }
+        if(e.type != DT_REG)
+            continue;
+        const int helper = extensions.match(e.name);
+        if(helper < 0)
+            continue;
+        if((maxFileSize || previous || current) && !statDone)   {   /// size and mtime are needed
+            if(::fstatat(fd, e.name.c_str(), &est, 0) != 0 || !S_ISREG(est.st_mode))
+                continue;
+            statDone = true;
+        }
+        if(  (maxFileSize && static_cast<unsigned long long>(est.st_size) > maxFileSize)
+          || (!fromJournal && isIgnored(rules.get(), relName, false)) )  {
+            ++skippedFiles;
+            continue;
+        }
+        std::string fullName = t.path + "/" + e.name;
+        const inodeType&& inode = statDone ? inodeType(est.st_dev, est.st_ino) : inodeType(dirDevice, e.inode);
+        const bool&& linked = statDone && (viaLink || est.st_nlink > 1);     /// it may have other names, in any order
+        if(!linked && isDuplicate(visitedFiles, inode, fullName))   /// keeps duplicated hits out of results
+            continue;
+        if(current)
+            record.files.push_back(Journal::fileRecord { e.name, mtimeOf(est), static_cast<unsigned long long>(est.st_size)
+                                                      , static_cast<unsigned long long>(est.st_dev), est.st_ino });
+        if(previous)    {   /// unchanged files are not yielded
+            const auto&& pf = prevFiles.find(e.name);
+            if(  pf != prevFiles.cend()
+              && pf ->second ->mtime == mtimeOf(est)
+              && pf ->second ->size == static_cast<unsigned long long>(est.st_size) )
+                continue;
+        }
+        if(linked)  {   /// yielded under the smallest name once all the names are known
+            std::lock_guard<std::mutex> lk(deferredMutex);
+            linkedFiles[inode].emplace_back(std::move(fullName), helper);
+            continue;
+        }
+        yield(std::move(fullName), helper);
+    }
+    ::close(fd);
+    if(current && !stopped)
+        current ->record(t.relPath, std::move(record));
+}
+
+std::shared_ptr<const XDGSearch::IgnoreNode> XDGSearch::poolIgnoreRules(const walkerType& w)
+{
+    std::shared_ptr<IgnoreNode> confRules(new IgnoreNode { IgnoreRules(""), nullptr });   /// the pool's .conf file rules have the lowest precedence
+    std::istringstream issPat(std::get<EXCLUDEPATTERNS>(w));
+    for(std::string p; std::getline(issPat, p, ','); /* null */)
+        confRules ->rules.addPattern(p);
+    return confRules;
+}
+
+std::shared_ptr<const XDGSearch::IgnoreNode> XDGSearch::withIgnoreFiles( const std::shared_ptr<const IgnoreNode>& parent
+                                                                       , const std::string& dirPath
+                                                                       , const std::string& relPath)
+{
+    std::shared_ptr<IgnoreNode> dirRules(new IgnoreNode { IgnoreRules(relPath), parent });  /// they apply to its descendants only
+    dirRules ->rules.loadFile(dirPath + "/.gitignore");
+    dirRules ->rules.loadFile(dirPath + "/.xdgsearchignore");   /// read last so it can override .gitignore
+    if(dirRules ->rules.empty())
+        return parent;
+    return dirRules;
+}
+
+bool XDGSearch::isIgnored(const IgnoreNode* r, const std::string& relPath, bool isDir)
+{
+    for(/* null */; r; r = r ->parent.get())  {     /// deeper ignore files override the shallower ones
+        const auto&& m = r ->rules.match(relPath, isDir);
+        if(m != IgnoreRules::Match::NONE)
+            return m == IgnoreRules::Match::EXCLUDED;
+    }
+    return false;
+}
+
+XDGSearch::HelperExtensions::HelperExtensions(const std::vector<std::string>& helpersExtensions)
+{
+    for(const auto& ext : helpersExtensions)    {
+        std::istringstream issExt(ext);     /// stringstream object for comma separated extensions list
+        extensions.emplace_back();
+        for(std::string e; std::getline(issExt, e, ','); /* null */)    {
+            if(e.empty())
+                continue;
+            std::transform(e.begin(), e.end(), e.begin(), ::tolower);
+            extensions.back().push_back("." + e);
+        }
+    }
+}
+
+int XDGSearch::HelperExtensions::match(const std::string& name) const
+{
+    for(std::size_t h = 0; h != extensions.size(); ++h)     /// the first helper listed in the pool wins
+        for(const auto& e : extensions[h])  /// like QDir name filters the match is case insensitive
+            if(name.size() > e.size()
+               && std::equal(e.cbegin(), e.cend(), name.cend() - e.size()
+                            , [] (char a, char b) { return a == std::tolower(static_cast<unsigned char>(b)); }))
+                return h;
+    return -1;
+}
+
+bool XDGSearch::Walker::isDuplicate(std::vector<inodeShard>& shards, const inodeType& inode, const std::string& fullName)
+{
+    auto& shard = shards[inodeHash()(inode) % shards.size()];
+    std::string first;
+    {
+        std::lock_guard<std::mutex> lk(shard.m);
+        const auto&& ins = shard.visited.emplace(inode, fullName);
+        if(ins.second || ins.first ->second == fullName)    /// claimed ahead by nextPhase()
+            return false;
+        first = ins.first ->second;
+    }
+    std::lock_guard<std::mutex> lk(duplicatesMutex);
+    duplicates.emplace_back(fullName, first);    /// a sym-link loop, a sym-link to a walked tree or a hard link
+    return true;
+}
+
+void XDGSearch::Walker::yield(std::string&& fullName, unsigned int helper)
+{
+    std::unique_lock<std::mutex> lk(outMutex);
+    outRoom.wait(lk, [this] { return found.size() < MAXQUEUEDFILES || stopped; });    /// a slow consumer bounds the memory held by the names
+    if(stopped)
+        return;
+    found.emplace_back(std::move(fullName), helper);
+    ++foundFiles;
+    outReady.notify_one();
+}
+
+bool XDGSearch::Walker::hasNext()
+{
+    if(hasPending)
+        return true;
+    std::unique_lock<std::mutex> lk(outMutex);
+    outReady.wait(lk, [this] { return !found.empty() || runningCrawlers == 0 || stopped; });
+    if(found.empty() || stopped)
+        return false;
+    pending = std::move(found.front());
+    found.pop_front();
+    outRoom.notify_one();
+    hasPending = true;
+    return true;
+}
+
+std::string XDGSearch::Walker::next()
+{
+    hasNext();
+    hasPending = false;
+    currentHelper = pending.second;
+    return std::move(pending.first);
+}
@@ -0,0 +1,181 @@
+/* XDGSearch is a XAPIAN based file indexer and search tool.
+
+    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef XDGSEARCH_INCLUDED_WALKER_H
+#define XDGSEARCH_INCLUDED_WALKER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <sys/types.h>
+#include "configuration.h"
+#include "journal.h"
+
+namespace XDGSearch {
+class IgnoreRules;          /// gitignore style patterns read from the .conf file, .gitignore and .xdgsearchignore files
+struct IgnoreNode;          /// the ignore rules active in a directory: its own ones chained to the ancestors' ones
+class HelperExtensions;     /// tells which helper, if any, handles a file name
+class Walker;               /// parallel crawler of the pool directory yielding the files to index, excluded directories are pruned
+bool globMatch(const char*, const char*);   /// gitignore flavoured wildcard match: *, ?, [...] and **
+std::shared_ptr<const IgnoreNode> poolIgnoreRules(const walkerType&);  /// the .conf file patterns, the root of every chain
+std::shared_ptr<const IgnoreNode> withIgnoreFiles( const std::shared_ptr<const IgnoreNode>&
+                                                 , const std::string&       /// fully qualified directory name
+                                                 , const std::string& );    /// pool relative one
+bool isIgnored(const IgnoreNode*, const std::string&, bool);    /// a pool relative path, deeper ignore files override the shallower ones
+}
+
+class XDGSearch::IgnoreRules final {
+public:
+    enum class Match { NONE, EXCLUDED, INCLUDED };
+    explicit IgnoreRules(const std::string& b) : base(b)  { }   /// base is the directory, relative to the pool one, the patterns refer to
+    void addPattern(std::string);               /// parse a single gitignore line
+    bool loadFile(const std::string&);          /// parse each line of an ignore file, false if the file can't be read
+    Match match(const std::string&, bool) const;    /// evaluate a path relative to the pool directory, the last matching pattern wins
+    bool empty() const                          { return rules.empty(); }
+    const std::string& getBase() const          { return base; }
+private:
+    struct rule {
+        std::string pattern;
+        bool negated;       /// leading '!': re-include what a previous pattern excluded
+        bool dirOnly;       /// trailing '/': it matches directories only
+        bool anchored;      /// a '/' inside the pattern: it matches relative to base, otherwise the bare name at any depth
+    };
+    std::string base;
+    std::vector<rule> rules;
+};
+
+struct XDGSearch::IgnoreNode {
+    IgnoreRules rules;
+    std::shared_ptr<const IgnoreNode> parent;
+};
+
+class XDGSearch::HelperExtensions final {
+public:
+    explicit HelperExtensions(const std::vector<std::string>&);     /// comma separated extensions of each helper
+    int match(const std::string&) const;        /// index of the helper whose extensions match, -1 if none
+private:
+    std::vector<std::vector<std::string>> extensions;   /// for each helper: lower case, dot prefixed, e.g.: .pdf
+};
+
+/// The pool directory is crawled by a few threads reading directories with getdents64(2): the d_type field
+/// avoids a stat(2) for each entry, only sym-links and file systems not filling d_type need one.
+/// Each thread pops directories from its own queue and steals from the others' when it runs dry,
+/// the files found are handed to the consumer as soon as they are found through hasNext()/next().
+/// Given the journal of the previous scan only new or changed files are yielded and the directories
+/// whose mtime didn't change are not read, given a journal to fill each walked directory is recorded.
+/// An object reached by more names is walked under one of them whatever the crawlers' timing: the directories
+/// reached through a sym-link are walked once the others are, in name order, and the files that may have other
+/// names, sym-links and hard links, are yielded at the end under the smallest one, unless a file with a single
+/// link holds their inode: then its own name is kept.
+/// Given a sub-tree or a file only that one is walked, as the walk of the whole pool would: the ignore files of
+/// its ancestors apply and its depth is counted from the pool directory.
+class XDGSearch::Walker final {
+public:
+    Walker( const std::string&                  /// pool directory
+          , const std::vector<std::string>&     /// comma separated extensions of each helper
+          , const walkerType&                   /// walking rules
+          , unsigned int = 0                    /// crawling threads, 0 means automatic
+          , const Journal* = nullptr            /// journal of the previous scan
+          , Journal* = nullptr                  /// journal of this scan
+          , const std::string& = std::string() );   /// pool relative sub-tree or file to walk, empty for the whole pool
+    Walker(Walker&&) = delete;
+    Walker& operator=(Walker&&) = delete;
+    ~Walker();                  /// stops the crawl and joins the threads
+    bool hasNext();             /// true if there is one more file to index, it waits for the crawlers
+    std::string next();         /// fully qualified name of the next file to index
+    unsigned int getHelper() const              { return currentHelper; }   /// index of the extensions the last next() file matched
+    unsigned int getFoundFiles() const          { return foundFiles; }      /// files found so far
+    bool isCrawling() const                     { return runningCrawlers != 0; }
+    void stop();                /// abandon the crawl, hasNext() returns false from now on
+    unsigned int getPrunedDirectories() const   { return prunedDirectories; }
+    unsigned int getSkippedFiles() const        { return skippedFiles; }
+    /// each pair holds the skipped name and the name kept that refers to the same device and inode,
+    /// to be read once hasNext() returned false
+    const std::vector<std::pair<std::string, std::string>>& getDuplicates() const   { return duplicates; }
+private:
+    using inodeType = std::pair<dev_t, ino_t>;
+    struct inodeHash {
+        std::size_t operator()(const inodeType& i) const  { return std::hash<unsigned long long>()(i.second * 31 + i.first); }
+    };
+    struct dirTask {
+        std::string path, relPath;          /// fully qualified and pool relative directory name
+        unsigned int depth;                 /// 0 for the pool directory
+        std::shared_ptr<const IgnoreNode> rules;
+        bool forceReaddir;                  /// an ancestor's ignore files changed: the journal can't be trusted
+    };
+    struct taskQueue {                      /// directories waiting to be read, one queue for each crawler
+        std::mutex m;
+        std::deque<dirTask> tasks;
+    };
+    struct inodeShard {                     /// visited objects, sharded to keep the crawlers from contending a single lock
+        std::mutex m;
+        std::unordered_map<inodeType, std::string, inodeHash> visited;
+    };
+    enum { SHARDS = 16, MAXQUEUEDFILES = 16384 };
+
+    void startAt(const std::string&, const std::string&, std::shared_ptr<const IgnoreNode>);   /// the first task of a sub-tree walk
+    void crawler(unsigned int);             /// body of each crawling thread
+    void crawlDirectory(unsigned int, const dirTask&);
+    void pushTask(unsigned int, dirTask&&);
+    bool popTask(unsigned int, dirTask&);   /// pops from the own queue back, otherwise steals from another queue front
+    void wakeIdle(bool);                    /// one idle crawler, or all of them when true
+    void nextPhase(unsigned int);           /// once no task is left: the sym-linked directories, then the files with more names
+    bool isDuplicate(std::vector<inodeShard>&, const inodeType&, const std::string&);    /// true if the object was already visited
+    void yield(std::string&&, unsigned int);
+
+    const HelperExtensions extensions;
+    const unsigned int maxDepth;
+    const unsigned long long maxFileSize;
+    const bool skipHidden;
+    const Journal* const previous;
+    Journal* const current;
+
+    std::vector<std::unique_ptr<taskQueue>> queues;
+    std::atomic<unsigned int> outstandingTasks, queuedTasks, runningCrawlers, idleCrawlers;
+    std::atomic<bool> stopped;
+    std::mutex idleMutex;
+    std::condition_variable idleCv;         /// crawlers with no directory to read wait here
+
+    std::mutex deferredMutex;               /// it guards the two containers below
+    std::vector<std::pair<inodeType, dirTask>> linkedDirs;      /// directories reached through a sym-link, not walked yet
+    std::unordered_map<inodeType, std::vector<std::pair<std::string, unsigned int>>, inodeHash>
+            linkedFiles;                    /// names of the files that may have more names, with their helper index
+
+    std::mutex outMutex;
+    std::condition_variable outReady, outRoom;
+    std::deque<std::pair<std::string, unsigned int>> found;     /// files found and not yet consumed with their helper index
+    std::pair<std::string, unsigned int> pending;               /// the file next() will return
+    bool hasPending;
+    unsigned int currentHelper;
+
+    std::vector<inodeShard> visitedDirs, visitedFiles;  /// the first name under which each (device, inode) was walked
+    std::mutex duplicatesMutex;
+    std::vector<std::pair<std::string, std::string>> duplicates;
+    std::atomic<unsigned int> foundFiles, prunedDirectories, skippedFiles;
+
+    std::vector<std::thread> crawlers;      /// last member: threads start once everything else is initialized
+};
+
+#endif /// XDGSEARCH_INCLUDED_WALKER_H
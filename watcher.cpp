@@ -0,0 +1,273 @@
+/* XDGSearch is a XAPIAN based file indexer and search tool.
+
+    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "watcher.h"
+#include <iostream>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+
+namespace {
+const uint32_t watchMask = IN_CREATE | IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO
+                         | IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK;
+const std::size_t maxChanges = 100000;     /// beyond it a rescan is cheaper than replacing each file
+}
+
+XDGSearch::Watcher::Watcher(const callbackType& c, unsigned int quiet, unsigned int rescan) :
+      callback(c)
+    , quietTime(quiet)
+    , rescanTime(rescan)
+    , inotifyFd(::inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+    , started(false)
+{
+    if(inotifyFd < 0)   /// out of inotify instances: every pool falls back to periodic rescans
+        std::clog << "inotify: " << std::strerror(errno) << ", pools will be rescanned every " << rescan << " minutes" << std::endl;
+    if(::pipe2(stopFd, O_CLOEXEC) != 0)    {
+        std::cerr << "pipe: " << std::strerror(errno) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+}
+
+XDGSearch::Watcher::~Watcher()
+{
+    if(started) {
+        const char&& c = 0;
+        while(::write(stopFd[1], &c, 1) < 0 && errno == EINTR)
+            ;
+        watching.join();
+    }
+    if(inotifyFd >= 0)
+        ::close(inotifyFd);
+    ::close(stopFd[0]);
+    ::close(stopFd[1]);
+}
+
+void XDGSearch::Watcher::addPool(const Pool& p, const std::string& dirPath, const walkerType& w)
+{
+    std::string root = dirPath;
+    while(root.size() > 1 && root.back() == '/')
+        root.pop_back();
+
+    pools.emplace_back(new poolState(p, root, w));
+}
+
+void XDGSearch::Watcher::start()
+{
+    started = true;
+    watching = std::thread(&Watcher::run, this);
+}
+
+bool XDGSearch::Watcher::isWatched(const Pool& p) const
+{
+    for(const auto& ps : pools)
+        if(ps ->pool == p)
+            return !ps ->fallback;
+    return false;
+}
+
+void XDGSearch::Watcher::run()
+{
+    for(unsigned int i = 0; i != pools.size(); ++i)
+        if(inotifyFd < 0 || !watchTree(i, pools[i] ->root, 0, pools[i] ->rules))
+            fallBack(i);
+
+    while(true) {
+        pollfd fds[2] = { { inotifyFd, POLLIN, 0 }, { stopFd[0], POLLIN, 0 } };
+        const int&& n = ::poll(fds, 2, 1000);   /// wakes up each second to hand over the pools gone quiet
+        if(n < 0 && errno != EINTR)    {
+            std::cerr << "poll: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        if(n > 0 && (fds[0].revents & POLLIN))
+            readEvents();
+        if(n > 0 && fds[1].revents)    {    /// the watcher is being destroyed: nothing gathered is left behind
+            handOver(true);
+            break;
+        }
+        handOver(false);
+    }
+}
+
+bool XDGSearch::Watcher::watchTree(unsigned int p, const std::string& dirPath, unsigned int depth, const std::shared_ptr<const IgnoreNode>& parentRules)
+{
+    const auto& ps = *pools[p];
+    std::vector<watchTarget> toWatch { watchTarget { p, dirPath, depth, parentRules } };    /// an explicit stack: deep trees
+    while(!toWatch.empty()) {                                                               /// don't deepen the call stack
+        watchTarget target = std::move(toWatch.back());
+        toWatch.pop_back();
+        const std::string& dir = target.path;
+        target.rules = withIgnoreFiles(target.rules, dir, dir.size() > ps.root.size() ? dir.substr(ps.root.size() + 1) : std::string());
+
+        const int&& wd = ::inotify_add_watch(inotifyFd, dir.c_str(), watchMask);
+        if(wd < 0)  {
+            if(errno == ENOSPC || errno == ENOMEM)  /// fs.inotify.max_user_watches reached
+                return false;
+            continue;           /// gone meanwhile or not readable
+        }
+        auto& targets = watches[wd];
+        bool known = false;
+        for(const auto& t : targets)
+            known = known || (t.pool == p && t.path == dir);
+        if(!known)
+            targets.push_back(target);
+
+        DIR* d = ::opendir(dir.c_str());
+        if(!d)
+            continue;
+        for(dirent* e; (e = ::readdir(d)); /* null */)  {
+            const std::string name = e ->d_name;
+            if(name == "." || name == "..")
+                continue;
+            bool isDir = e ->d_type == DT_DIR;
+            if(e ->d_type == DT_UNKNOWN)   {   /// file systems not filling d_type
+                struct stat st;
+                isDir = ::fstatat(::dirfd(d), e ->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(st.st_mode);
+            }
+            if(isDir && isWanted(ps, target, name, true))
+                toWatch.push_back(watchTarget { p, dir + "/" + name, target.depth + 1, target.rules });
+        }
+        ::closedir(d);
+    }
+    return true;
+}
+
+void XDGSearch::Watcher::unwatchTree(unsigned int p, const std::string& dirPath)
+{
+    const std::string prefix = dirPath + "/";
+    for(auto w = watches.begin(); w != watches.end(); /* null */)  {
+        auto& targets = w ->second;
+        for(auto t = targets.begin(); t != targets.end(); /* null */)
+            if(t ->pool == p && (t ->path == dirPath || t ->path.compare(0, prefix.size(), prefix) == 0))
+                t = targets.erase(t);
+            else
+                ++t;
+        if(targets.empty()) {
+            ::inotify_rm_watch(inotifyFd, w ->first);
+            w = watches.erase(w);
+        } else
+            ++w;
+    }
+}
+
+void XDGSearch::Watcher::readEvents()
+{
+    alignas(inotify_event) char buf[65536];     /// room for at least a thousand events each read
+    while(true) {
+        const ssize_t&& len = ::read(inotifyFd, buf, sizeof buf);
+        if(len <= 0)    /// EAGAIN: drained
+            break;
+        for(const char* ptr = buf; ptr < buf + len; /* null */)  {
+            const inotify_event* ev = reinterpret_cast<const inotify_event*>(ptr);
+            ptr += sizeof(inotify_event) + ev ->len;
+
+            if(ev ->mask & IN_Q_OVERFLOW)   {   /// events were dropped: the journal tells what changed
+                for(auto& ps : pools)
+                    if(!ps ->fallback)
+                        noteChange(*ps, std::string());
+                continue;
+            }
+            const auto&& w = watches.find(ev ->wd);
+            if(w == watches.end())
+                continue;
+            if(ev ->mask & IN_IGNORED)  {   /// the directory was removed, its watch is gone
+                watches.erase(w);
+                continue;
+            }
+            if(!ev ->len)
+                continue;
+            const std::vector<watchTarget> targets = w ->second;   /// watchTree() may rehash watches
+            const bool&& isDir = ev ->mask & IN_ISDIR;
+            for(const auto& t : targets)    {
+                auto& ps = *pools[t.pool];
+                if(ps.fallback)
+                    continue;
+                if(!isWanted(ps, t, ev ->name, isDir))
+                    continue;
+                std::string fullName = t.path + "/" + ev ->name;
+                if(isDir && (ev ->mask & IN_MOVED_FROM))
+                    unwatchTree(t.pool, fullName);
+                if(isDir && (ev ->mask & (IN_CREATE | IN_MOVED_TO)) && !watchTree(t.pool, fullName, t.depth + 1, t.rules))  {
+                    fallBack(t.pool);
+                    continue;
+                }
+                noteChange(ps, std::move(fullName));    /// a directory is walked again by the indexer
+            }
+        }
+    }
+}
+
+void XDGSearch::Watcher::noteChange(poolState& ps, std::string&& fullName)
+{
+    const auto&& now = clockType::now();
+    if(ps.changed.empty() && !ps.rescan)
+        ps.firstChange = now;
+    ps.lastChange = now;
+    if(fullName.empty() || ps.changed.size() >= maxChanges)     {
+        ps.rescan = true;
+        ps.changed.clear();
+    } else if(!ps.rescan)   /// a rescan finds this change as well
+        ps.changed.insert(std::move(fullName));
+}
+
+void XDGSearch::Watcher::handOver(bool all)
+{
+    const auto&& now = clockType::now();
+    for(auto& ps : pools)   {
+        if(ps ->fallback)   {
+            if(now - ps ->lastRescan >= rescanTime && callback(ps ->pool, std::vector<std::string>(), true))
+                ps ->lastRescan = now;
+            continue;
+        }
+        if(ps ->changed.empty() && !ps ->rescan)
+            continue;
+        if(!all && now - ps ->lastChange < quietTime && now - ps ->firstChange < quietTime * 15)   /// still busy, but not forever
+            continue;
+        const std::vector<std::string> changed(ps ->changed.cbegin(), ps ->changed.cend());
+        if(callback(ps ->pool, ps ->rescan ? std::vector<std::string>() : changed, ps ->rescan))   {
+            ps ->changed.clear();
+            ps ->rescan = false;
+        } else
+            ps ->firstChange = ps ->lastChange = now;   /// kept for a later attempt
+    }
+}
+
+bool XDGSearch::Watcher::isWanted(const poolState& ps, const watchTarget& t, const std::string& name, bool isDir) const
+{
+    if(isDir && ((ps.skipHidden && name.front() == '.') || (ps.maxDepth && t.depth + 1 > ps.maxDepth)))   /// the walker's pruning
+        return false;
+    const std::string&& relName = t.path.size() > ps.root.size() ? t.path.substr(ps.root.size() + 1) + "/" + name : name;
+    return !isIgnored(t.rules.get(), relName, isDir);
+}
+
+void XDGSearch::Watcher::fallBack(unsigned int p)
+{
+    auto& ps = *pools[p];
+    if(inotifyFd >= 0)
+        std::clog << ps.root << ": out of inotify watches, rescanning every " << rescanTime.count() << " minutes" << std::endl;
+    unwatchTree(p, ps.root);
+    ps.changed.clear();
+    ps.rescan = false;
+    ps.lastRescan = clockType::now();
+    ps.fallback = true;
+}
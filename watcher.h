@@ -0,0 +1,101 @@
+/* XDGSearch is a XAPIAN based file indexer and search tool.
+
+    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef XDGSEARCH_INCLUDED_WATCHER_H
+#define XDGSEARCH_INCLUDED_WATCHER_H
+
+#include <string>
+#include <vector>
+#include <set>
+#include <memory>
+#include <unordered_map>
+#include <functional>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include "configuration.h"
+#include "walker.h"
+
+namespace XDGSearch {
+class Watcher;              /// keeps an eye on the pool directories through inotify(7) and reports what changed
+}
+
+/// Each directory of the watched pools gets an inotify watch. The changed names are gathered until the pool stays
+/// quiet for a while, so a burst like a git checkout ends into a single update, then they are handed to the callback.
+/// When the kernel queue overflows the pool is asked for a rescan, which the journal keeps cheap, in order not to lose
+/// any change; when the watches are exhausted (see fs.inotify.max_user_watches) the pool is rescanned periodically.
+class XDGSearch::Watcher final {
+public:
+    using clockType = std::chrono::steady_clock;
+    /// it receives the pool, the changed files and directories or, when the bool is true, a request to rescan the pool;
+    /// it returns false when the pool can't be updated now: the same changes are handed again later
+    using callbackType = std::function<bool(const Pool&, const std::vector<std::string>&, bool)>;
+
+    Watcher( const callbackType&
+           , unsigned int = 2          /// seconds of quiet before the gathered changes are handed
+           , unsigned int = 30 );      /// minutes between rescans of the pools that can't be watched
+    Watcher(Watcher&&) = delete;
+    Watcher& operator=(Watcher&&) = delete;
+    ~Watcher();                         /// stops the watching thread
+    void addPool(const Pool&, const std::string&, const walkerType&);  /// to be called before start()
+    void start();                       /// the watches are put from the watching thread, it doesn't hold the caller
+    bool isWatched(const Pool&) const;  /// false when the pool fell back to periodic rescans
+private:
+    struct poolState {
+        poolState(const Pool& p, const std::string& r, const walkerType& w) :
+              pool(p), root(r), rules(poolIgnoreRules(w)), maxDepth(std::get<MAXDEPTH>(w)), skipHidden(std::get<SKIPHIDDEN>(w))
+            , fallback(false), rescan(false)  { }
+        Pool pool;
+        std::string root;
+        std::shared_ptr<const IgnoreNode> rules;    /// the .conf file ones, each watched directory chains its ignore files to them
+        unsigned int maxDepth;
+        bool skipHidden;
+        std::atomic<bool> fallback;         /// watches exhausted: periodic rescans
+        bool rescan;                        /// overflow: rescan at the next hand over
+        std::set<std::string> changed;      /// changed names gathered so far, a set coalesces repeated events
+        clockType::time_point firstChange, lastChange, lastRescan;
+    };
+    struct watchTarget {
+        unsigned int pool;                  /// index into pools
+        std::string path;                   /// fully qualified directory name
+        unsigned int depth;                 /// 0 for the pool directory
+        std::shared_ptr<const IgnoreNode> rules;    /// the ones active into it, its own ignore files included
+    };
+
+    void run();                             /// body of the watching thread
+    bool watchTree( unsigned int, const std::string&    /// watches a directory and its sub-directories, false when out of watches
+                  , unsigned int                        /// its depth
+                  , const std::shared_ptr<const IgnoreNode>& );     /// its parent's ignore rules
+    void unwatchTree(unsigned int, const std::string&);
+    void readEvents();
+    void handOver(bool);                    /// hands the changes of the quiet pools, all of them when true
+    bool isWanted(const poolState&, const watchTarget&, const std::string&, bool) const;  /// a name into a watched directory the walker would walk
+    void fallBack(unsigned int);
+    void noteChange(poolState&, std::string&&);     /// an empty name asks for a rescan
+
+    const callbackType callback;
+    const std::chrono::seconds quietTime;
+    const std::chrono::minutes rescanTime;
+    std::vector<std::unique_ptr<poolState>> pools;
+    std::unordered_map<int, std::vector<watchTarget>> watches;  /// a directory shared by two pools has a single watch descriptor
+    int inotifyFd, stopFd[2];               /// the pipe wakes the thread up when the watcher is destroyed
+    std::atomic<bool> started;
+    std::thread watching;
+};
+
+#endif /// XDGSEARCH_INCLUDED_WATCHER_H
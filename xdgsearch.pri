@@ -0,0 +1,31 @@
+# XDGSearch is a XAPIAN based file indexer and search tool.
+#
+#    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+#
+#    This program is free software: you can redistribute it and/or modify
+#    it under the terms of the GNU General Public License as published by
+#    the Free Software Foundation, either version 3 of the License, or
+#    (at your option) any later version.
+#
+#    This program is distributed in the hope that it will be useful,
+#    but WITHOUT ANY WARRANTY; without even the implied warranty of
+#    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#    GNU General Public License for more details.
+#
+#    You should have received a copy of the GNU General Public License
+#    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# Settings shared by the core library and the application
+
+INCLUDEPATH += /usr/include/xapian
+CONFIG   += c++11
+QMAKE_CXXFLAGS *= $(shell dpkg-buildflags --get CXXFLAGS)
+
+# The application version
+VERSION = 0.20.1
+
+# Defines the preprocessor macro to get the application version available in the application code
+DEFINES += APP_VERSION=\\\"$$VERSION\\\"
+
+# Counts the heap allocations of the indexing, it replaces the global operator new: qmake CONFIG+=countallocations
+countallocations: DEFINES += XDGSEARCH_COUNT_ALLOCATIONS
@@ -22,53 +22,11 @@
 #
 #-------------------------------------------------
 
-INCLUDEPATH += /usr/include/xapian
-QT      += core gui
+TEMPLATE = subdirs
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
-CONFIG   += c++11
-QMAKE_CXXFLAGS *= $(shell dpkg-buildflags --get CXXFLAGS)
+SUBDIRS += core app
+core.file = xdgsearchcore.pro
+app.file  = xdgsearchapp.pro
+app.depends = core
 
-TARGET = xdgsearch
-TEMPLATE = app
-LIBS     += -lQt5Core \
-            -lQt5Gui \
-            -lQt5Widgets \
-            -lxapian \
-            -pthread
-
-# The application version
-VERSION = 0.20.1
-
-# Defines the preprocessor macro to get the application version available in the application code
-DEFINES += APP_VERSION=\\\"$$VERSION\\\"
-
-SOURCES += main.cpp\
-    mainwindow.cpp \
-    configuration.cpp \
-    wizard.cpp \
-    indexer.cpp \
-    preferences.cpp \
-    helpers.cpp
-
-HEADERS  += mainwindow.h \
-    configuration.h \
-    wizard.h \
-    indexer.h \
-    preferences.h \
-    helpers.h
-
-FORMS    += mainwindow.ui \
-    wizard.ui \
-    preferences.ui \
-    helpers.ui
-
-RESOURCES += \
-    resources.qrc
-
-DISTFILES += \
-    COPYING \
-    icon/COPYING \
-    icon/COPYING.LESSER \
-    icon/README.md \
-    README.md
+DISTFILES += xdgsearch.pri
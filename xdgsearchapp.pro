@@ -0,0 +1,65 @@
+# XDGSearch is a XAPIAN based file indexer and search tool.
+#
+#    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+#
+#    This program is free software: you can redistribute it and/or modify
+#    it under the terms of the GNU General Public License as published by
+#    the Free Software Foundation, either version 3 of the License, or
+#    (at your option) any later version.
+#
+#    This program is distributed in the hope that it will be useful,
+#    but WITHOUT ANY WARRANTY; without even the implied warranty of
+#    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#    GNU General Public License for more details.
+#
+#    You should have received a copy of the GNU General Public License
+#    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+# The desktop application, it also answers to the headless subcommands: see cli.h
+
+include(xdgsearch.pri)
+
+QT      += core gui
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+TARGET = xdgsearch
+TEMPLATE = app
+LIBS     += -L$$OUT_PWD -lxdgsearchcore \
+            -lQt5Core \
+            -lQt5Gui \
+            -lQt5Widgets \
+            -lxapian \
+            -lzstd \
+            -pthread
+
+PRE_TARGETDEPS += $$OUT_PWD/libxdgsearchcore.a
+
+SOURCES += main.cpp\
+    mainwindow.cpp \
+    wizard.cpp \
+    preferences.cpp \
+    helpers.cpp \
+    cli.cpp
+
+HEADERS  += mainwindow.h \
+    wizard.h \
+    preferences.h \
+    helpers.h \
+    cli.h
+
+FORMS    += mainwindow.ui \
+    wizard.ui \
+    preferences.ui \
+    helpers.ui
+
+RESOURCES += \
+    resources.qrc
+
+DISTFILES += \
+    COPYING \
+    icon/COPYING \
+    icon/COPYING.LESSER \
+    icon/README.md \
+    README.md
@@ -0,0 +1,59 @@
+# XDGSearch is a XAPIAN based file indexer and search tool.
+#
+#    Copyright (C) 2016,2017,2018,2019  Franco Martelli
+#
+#    This program is free software: you can redistribute it and/or modify
+#    it under the terms of the GNU General Public License as published by
+#    the Free Software Foundation, either version 3 of the License, or
+#    (at your option) any later version.
+#
+#    This program is distributed in the hope that it will be useful,
+#    but WITHOUT ANY WARRANTY; without even the implied warranty of
+#    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#    GNU General Public License for more details.
+#
+#    You should have received a copy of the GNU General Public License
+#    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# UI-free core: configuration, walking, indexing and querying, shared by the GUI and the command line
+
+include(xdgsearch.pri)
+
+QT       = core
+TARGET   = xdgsearchcore
+TEMPLATE = lib
+CONFIG  += staticlib
+
+SOURCES += configuration.cpp \
+    indexer.cpp \
+    walker.cpp \
+    journal.cpp \
+    watcher.cpp \
+    textcache.cpp \
+    hash.cpp \
+    concurrency.cpp \
+    priority.cpp \
+    stats.cpp \
+    trace.cpp \
+    chunker.cpp \
+    markup.cpp \
+    stopwords.cpp \
+    stemcache.cpp \
+    doctext.cpp
+
+HEADERS += configuration.h \
+    indexer.h \
+    walker.h \
+    journal.h \
+    watcher.h \
+    textcache.h \
+    hash.h \
+    concurrency.h \
+    priority.h \
+    stats.h \
+    trace.h \
+    chunker.h \
+    markup.h \
+    stopwords.h \
+    stemcache.h \
+    doctext.h